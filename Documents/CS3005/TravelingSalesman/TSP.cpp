@@ -1,151 +1,181 @@
+#include "batch.h"
 #include "graph.h"
+#include "registry.h"
+#include "server.h"
+#include "shared.h"
 #include <cstdlib>
 #include <iostream>
 #include <fstream>
 #include <string>
-#include <ctime>
 #include <algorithm>
 
 
-std::vector<int> TSPNumericalOrder(Graph& g) {
-	std::vector<int> path;
-	std::vector<std::vector<double>> graph = g.getGraph();
-	path.push_back(1);
-	int current_vertex = 1;
-	for (size_t i = 0; i < graph.size() - 1; i++)
-	{
-		current_vertex += 1;
-		path.push_back(current_vertex);
-	}
-	return path;
-}
-
-std::vector<int> getRandomCycle(Graph& g) {
-	std::vector<int> path;
-	path = TSPNumericalOrder(g);
-	std::random_shuffle(path.begin()+1, path.end());
-	return path;
+int usage() {
+	std::cerr << "usage: TSP-3 [options] < graph.txt" << std::endl;
+	std::cerr << "       TSP-3 --batch <manifest|directory> [--threads N] [options]" << std::endl;
+	std::cerr << "       TSP-3 --serve <socket> [--cache N] [options]" << std::endl;
+	std::cerr << "       TSP-3 --list-solvers" << std::endl;
+	std::cerr << "options: --solver name[,name...] --budget ms --race --seed n --telemetry file.json" << std::endl;
+	std::cerr << "         --checkpoint file [--checkpoint-interval s] (with --solver anytime)" << std::endl;
+	std::cerr << "         --matrix-memory default|huge|interleave --quantise (read into 16-bit weights)" << std::endl;
+	std::cerr << "         --matrix-limit mb (larger coordinate inputs keep only their points)" << std::endl;
+	std::cerr << "         --result-cache directory [--refresh-cache]" << std::endl;
+	std::cerr << "         --progress (report reading on stderr) --load-neighbours k (build while reading)" << std::endl;
+	std::cerr << "         --share-graph name (put the graph in shared memory until this process exits)" << std::endl;
+	std::cerr << "         --attach-graph name (solve a shared graph instead of reading one)" << std::endl;
+	return 1;
 }
 
-std::vector<int> getRandomNeighbor(std::vector<int> path) {
-	int x, y,temp;
-	x = rand() % (path.size()-1)+1;
-	y = rand() % (path.size()-1)+1;
-	if (x==y)
+int listSolvers() {
+	const std::vector<SolverEntry>& entries = SolverRegistry::instance().getEntries();
+	for (size_t i = 0; i < entries.size(); i++)
 	{
-		while (x == y)
-		{
-			y = rand() % path.size();
-		}
+		std::cout << entries[i].name << "\t" << entries[i].description << std::endl;
 	}
-	temp = path[x];
-	path[x] = path[y];
-	path[y] = temp;
-	return path;
-
+	return 0;
 }
 
-
-std::vector<int> TSPHillClimb(Graph& g) {
-
-	std::vector<int> current_path, best_path,temp_path;
-	double best_quality = -1.0;
-	double temp_quality;
-	current_path = getRandomCycle(g);
-	double current_quality = g.getPathQuality(current_path);
-	while (current_quality > best_quality)
+int main(int argc, char* argv[]) {
+	std::string mode, target, telemetry_path, share_name, attach_name;
+	unsigned threads = threadCount();
+	size_t cache = 16;
+	SolveConfig config = defaultSolveConfig();
+	LoadOptions load = defaultLoadOptions();
+	bool progress = false;
+	for (int i = 1; i < argc; i++)
 	{
-		best_quality = current_quality;
-		best_path = current_path;
-		for (size_t i = 0; i < 100; i++)
+		std::string arg = argv[i];
+		bool has_value = i + 1 < argc;
+		if ((arg == "--batch" || arg == "--serve") && has_value && mode.empty())
+		{
+			mode = arg;
+			target = argv[++i];
+		}
+		else if (arg == "--threads" && has_value && std::atoi(argv[i + 1]) > 0)
 		{
-			temp_path = getRandomNeighbor(current_path);
-			temp_quality = g.getPathQuality(temp_path);
-			if (temp_quality>current_quality)
+			threads = std::atoi(argv[++i]);
+		}
+		else if (arg == "--cache" && has_value && std::atoi(argv[i + 1]) > 0)
+		{
+			cache = std::atoi(argv[++i]);
+		}
+		else if (arg == "--solver" && has_value)
+		{
+			config.solvers = splitSolverList(argv[++i]);
+		}
+		else if (arg == "--budget" && has_value && std::atol(argv[i + 1]) > 0)
+		{
+			config.budget = std::atol(argv[++i]);
+		}
+		else if (arg == "--telemetry" && has_value)
+		{
+			telemetry_path = argv[++i];
+		}
+		else if (arg == "--seed" && has_value)
+		{
+			config.seed = std::strtoull(argv[++i], NULL, 10);
+			config.deterministic = true;
+		}
+		else if (arg == "--checkpoint" && has_value)
+		{
+			config.checkpoint = argv[++i];
+		}
+		else if (arg == "--checkpoint-interval" && has_value && std::atof(argv[i + 1]) > 0)
+		{
+			config.checkpointInterval = std::atof(argv[++i]);
+		}
+		else if (arg == "--matrix-memory" && has_value)
+		{
+			MatrixPlacement placement;
+			if (!parseMatrixPlacement(argv[++i], placement))
 			{
-				current_quality = temp_quality;
-				current_path = temp_path;
-				break;
+				return usage();
 			}
+			setMatrixPlacement(placement);
 		}
-	}
-	return best_path;
-}
-
-std::vector<int> randomRestartHillClimb(Graph& g){
-	double best_quality = 0.0;
-	double current_quality;
-	std::vector<int> best_path, current_path;
-	for (size_t i = 0; i < 100; i++)
-	{
-		current_path = TSPHillClimb(g);
-		current_quality = g.getPathQuality(current_path);
-		if (current_quality>best_quality)
+		else if (arg == "--matrix-limit" && has_value && std::atol(argv[i + 1]) >= 0)
+		{
+			setMatrixLimit(size_t(std::atol(argv[++i])) * 1024 * 1024);
+		}
+		else if (arg == "--result-cache" && has_value)
 		{
-			best_path = current_path;
-			best_quality = current_quality;
+			config.resultCache = argv[++i];
 		}
-		if (best_quality>=.8)
+		else if (arg == "--refresh-cache")
 		{
-			return best_path;
+			config.refreshCache = true;
+		}
+		else if (arg == "--load-neighbours" && has_value && std::atoi(argv[i + 1]) >= 0)
+		{
+			load.neighbours = std::atoi(argv[++i]);
+		}
+		else if (arg == "--share-graph" && has_value && attach_name.empty())
+		{
+			share_name = argv[++i];
+		}
+		else if (arg == "--attach-graph" && has_value && share_name.empty())
+		{
+			attach_name = argv[++i];
+		}
+		else if (arg == "--progress")
+		{
+			progress = true;
+		}
+		else if (arg == "--quantise")
+		{
+			config.quantise = true;
+		}
+		else if (arg == "--race")
+		{
+			config.race = true;
+		}
+		else if (arg == "--list-solvers")
+		{
+			return listSolvers();
+		}
+		else
+		{
+			return usage();
 		}
 	}
-	return best_path;
-}
-
-//Path2 Function
-std::vector<int> TSPOddsEvens(Graph& g) {
-	std::vector<int> path;
-	std::vector<std::vector<double>> graph = g.getGraph();
-	path.push_back(1);
-	int current_vertex = 1;
-	for (size_t i = 0; i < ((graph.size() - 1)/2); i++)
+	std::string problem = checkSolveConfig(config);
+	if (!mode.empty() && !config.checkpoint.empty())
 	{
-		current_vertex += 2;
-		path.push_back(current_vertex);
+		problem = "--checkpoint only works on a single graph";
 	}
-	path.push_back(2);
-	current_vertex = 2;
-	for (size_t i = 0; i < ((graph.size() - 1) / 2); i++)
+	if (!mode.empty() && (!share_name.empty() || !attach_name.empty()))
 	{
-		current_vertex += 2;
-		path.push_back(current_vertex);
+		problem = "shared graphs only work on a single graph";
 	}
-	return path;
-}
-std::vector<int> TSPThrees(Graph& g) {
-	std::vector<int> path;
-	std::vector<std::vector<double>> graph = g.getGraph();
-	path.push_back(1);
-	int current_vertex = 1;
-	int last_vertex = graph.size();
-	while (current_vertex<(last_vertex-2))
+	if (!problem.empty())
 	{
-		current_vertex += 3;
-		path.push_back(current_vertex);
+		std::cerr << problem << std::endl;
+		return usage();
 	}
-		
-	
-	path.push_back(2);
-	current_vertex = 2;
-	while (current_vertex < (last_vertex - 2))
+	std::ofstream telemetry;
+	if (!telemetry_path.empty())
 	{
-		current_vertex += 3;
-		path.push_back(current_vertex);
+		telemetry.open(telemetry_path.c_str());
+		if (!telemetry)
+		{
+			std::cerr << "could not write " << telemetry_path << std::endl;
+			return 1;
+		}
 	}
-	path.push_back(3);
-	current_vertex = 3;
-	while (current_vertex < (last_vertex - 2))
+	if (mode == "--serve")
 	{
-		current_vertex += 3;
-		path.push_back(current_vertex);
+		return runServer(target, cache, config);
+	}
+	if (mode == "--batch")
+	{
+		std::vector<BatchInput> files = listBatchInputs(target);
+		if (files.empty())
+		{
+			std::cerr << "no graph files found in " << target << std::endl;
+			return 1;
+		}
+		return runBatch(files, std::cout, threads, config, telemetry_path.empty() ? NULL : &telemetry);
 	}
-	return path;
-}
-
-
-int main() {
-	std::srand(unsigned(std::time(0)));
 	////File Input
 	/*std::cout << "Input Filename?: ";
 	std::string infile;
@@ -155,57 +185,89 @@ int main() {
 	fin >> g;
 	fin.close();*/
 	//std Input
+	if (progress)
+	{
+		int reported = 0;
+		load.onProgress = [reported](int rows, int total) mutable {
+			int tenth = int(10LL * rows / total);
+			if (tenth > reported)
+			{
+				reported = tenth;
+				std::cerr << "read " << rows << " of " << total << " rows" << std::endl;
+			}
+		};
+	}
+	//A shared graph is published as doubles, so it is read unquantised.
+	load.quantise = config.quantise && share_name.empty();
 	Graph g;
-	std::cin >> g;
-
-	
-	g.setMaxWeight();
-	g.setMinWeight();
-
-	//std::vector<int> path = randomRestartHillClimb(g);
-
-	//1)Vertices in order
-	std::vector<int> path1 = TSPNumericalOrder(g);
-	double path_1_quality = g.getPathQuality(path1);
-	//2)Vertices with all Odds in order than all evens in order
-	std::vector<int> path2 = TSPOddsEvens(g);
-	double path_2_quality = g.getPathQuality(path2);
-	/*for (size_t i = 0; i < path2.size(); i++)
+	SharedInstance shared;
+	std::string error;
+	if (!attach_name.empty())
 	{
-		std::cout << path2[i] << ' ';
+		if (!shared.attach(attach_name, error))
+		{
+			std::cerr << "could not attach graph: " << error << std::endl;
+			return 1;
+		}
 	}
-	std::cout << path_2_weight << ' ' << path_2_quality << std::endl;
+	else
+	{
+		//Unsynced, std::cin reads in blocks instead of a character at a time.
+		std::ios::sync_with_stdio(false);
+		if (!loadGraph(std::cin, g, load, error))
+		{
+			std::cerr << "could not read graph: " << error << std::endl;
+			return 1;
+		}
 
-*/
-	//3)By Threes
-	std::vector<int> path3 = TSPThrees(g);
-	double path_3_quality = g.getPathQuality(path3);
-	/*for (size_t i = 0; i < path3.size(); i++)
+		if (!g.hasBounds())
+		{
+			g.setMaxWeight();
+			g.setMinWeight();
+		}
+		if (!share_name.empty())
+		{
+			if (!shared.create(share_name, g, error))
+			{
+				std::cerr << "could not share graph: " << error << std::endl;
+				return 1;
+			}
+			//Only the shared copy is needed from here on.
+			g.setSize(0);
+		}
+	}
+	Graph& graph = shared.isOpen() ? shared.getGraph() : g;
+	if (shared.isOpen())
 	{
-	std::cout << path3[i] << ' ';
+		config.onImprove = [&shared](const std::vector<int>& path, double weight, double) {
+			shared.publish(path, weight);
+		};
 	}
-	std::cout << path_3_weight << ' ' << path_3_quality << std::endl;
-*/
-	double best_quality = path_1_quality;
-	std::vector<int> best_path = path1;
-	if (path_2_quality>best_quality)
+
+	//std::vector<int> path = randomRestartHillClimb(g);
+
+	std::string json;
+	std::vector<int> best_path = solveWithConfig(graph, config, telemetry_path.empty() ? NULL : &json);
+	if (!telemetry_path.empty())
 	{
-		best_path = path2;
-		best_quality = path_2_quality;
+		telemetry << json << std::endl;
 	}
-	if (path_3_quality>best_quality)
+	if (shared.isOpen())
 	{
-		best_path = path3;
-		best_quality = path_3_quality;
+		//Finish with the best tour of every process sharing the graph.
+		double weight = graph.getPathWeight(best_path);
+		shared.publish(best_path, weight);
+		std::vector<int> path;
+		if (shared.readBest(path, weight) && weight < graph.getPathWeight(best_path))
+		{
+			best_path = path;
+		}
 	}
-	double best_weight = g.getPathWeight(best_path);
-	for (size_t i = 0; i < best_path.size(); i++)
+	writeResult(std::cout, graph, best_path);
+	if (!share_name.empty())
 	{
-		std::cout << best_path[i] << ' ';
+		SharedInstance::remove(share_name);
 	}
-	std::cout << best_weight << ' ' << best_quality << std::endl;
-
-
 
 	return 0;
 
@@ -0,0 +1,275 @@
+#include "aco.h"
+#include "parallel.h"
+#include "rng.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+double tourLength(const Graph& g, const std::vector<int>& tour) {
+	double length = 0.0;
+	for (size_t i = 0; i + 1 < tour.size(); i++)
+	{
+		length += g.getWeight(tour[i], tour[i + 1]);
+	}
+	length += g.getWeight(tour.back(), tour[0]);
+	return length;
+}
+
+bool isSymmetric(const Graph& g) {
+	int n = g.getSize();
+	for (int i = 0; i < n; i++)
+	{
+		for (int j = i + 1; j < n; j++)
+		{
+			if (g.getWeight(i, j) != g.getWeight(j, i))
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+std::vector<int> nearestNeighbourTour(const Graph& g) {
+	int n = g.getSize();
+	std::vector<int> tour;
+	std::vector<char> visited(n, 0);
+	int current = 0;
+	tour.push_back(current);
+	visited[current] = 1;
+	for (int step = 1; step < n; step++)
+	{
+		const double* row = g.getRow(current);
+		int next = -1;
+		for (int j = 0; j < n; j++)
+		{
+			if (!visited[j] && (next < 0 || row[j] < row[next]))
+			{
+				next = j;
+			}
+		}
+		tour.push_back(next);
+		visited[next] = 1;
+		current = next;
+	}
+	return tour;
+}
+
+//Clamp tau into [tauMin, tauMax] after evaporation and rebuild the
+//choice row. Both loops are branch-free over contiguous rows so the
+//compiler emits packed SIMD for them.
+void updateRow(double* tau, const double* eta, double* choice, size_t n,
+	double keep, double alpha, double tauMin, double tauMax) {
+	for (size_t j = 0; j < n; j++)
+	{
+		double x = tau[j] * keep;
+		x = x < tauMin ? tauMin : x;
+		tau[j] = x > tauMax ? tauMax : x;
+	}
+	if (alpha == 1.0)
+	{
+		for (size_t j = 0; j < n; j++)
+		{
+			choice[j] = tau[j] * eta[j];
+		}
+	}
+	else
+	{
+		for (size_t j = 0; j < n; j++)
+		{
+			choice[j] = std::pow(tau[j], alpha) * eta[j];
+		}
+	}
+}
+
+//`choice` is row-major n*n, like the graph's own matrix.
+std::vector<int> constructTour(const double* choice, int n, const NeighbourLists& candidates, int k,
+	CounterRng& rng) {
+	std::vector<int> tour;
+	tour.reserve(n);
+	std::vector<char> visited(n, 0);
+	int current = rng.below(n);
+	tour.push_back(current);
+	visited[current] = 1;
+	std::vector<double> weights;
+	for (int step = 1; step < n; step++)
+	{
+		const int* cand = candidates.getIds(current);
+		const double* row = choice + size_t(current) * n;
+		weights.resize(k);
+		double total = 0.0;
+		for (int c = 0; c < k; c++)
+		{
+			weights[c] = visited[cand[c]] ? 0.0 : row[cand[c]];
+			total += weights[c];
+		}
+		int next = -1;
+		if (total > 0.0)
+		{
+			double r = rng.unit() * total;
+			for (int c = 0; c < k; c++)
+			{
+				if (weights[c] > 0.0)
+				{
+					next = cand[c];
+					r -= weights[c];
+					if (r <= 0.0)
+					{
+						break;
+					}
+				}
+			}
+		}
+		else
+		{
+			//Every candidate is used up, fall back to the best remaining vertex.
+			for (int j = 0; j < n; j++)
+			{
+				if (!visited[j] && (next < 0 || row[j] > row[next]))
+				{
+					next = j;
+				}
+			}
+		}
+		tour.push_back(next);
+		visited[next] = 1;
+		current = next;
+	}
+	return tour;
+}
+
+//Rotate a 0-based tour so it starts at vertex 0 and renumber from 1,
+//which is what Graph::getPathWeight expects.
+std::vector<int> toPath(const std::vector<int>& tour) {
+	size_t n = tour.size();
+	size_t start = std::find(tour.begin(), tour.end(), 0) - tour.begin();
+	std::vector<int> path;
+	path.reserve(n);
+	for (size_t i = 0; i < n; i++)
+	{
+		path.push_back(tour[(start + i) % n] + 1);
+	}
+	return path;
+}
+
+}
+
+ACOParams defaultACOParams(const Graph& g) {
+	ACOParams params;
+	params.ants = std::min(std::max(g.getSize(), 10), 64);
+	params.iterations = 250;
+	params.candidates = 15;
+	params.alpha = 1.0;
+	params.beta = 2.0;
+	params.rho = 0.02;
+	params.seed = taskRng().next();
+	return params;
+}
+
+std::vector<int> TSPAntColony(Graph& g) {
+	return TSPAntColony(g, defaultACOParams(g));
+}
+
+std::vector<int> TSPAntColony(Graph& g, const ACOParams& params) {
+	SolveControl control(g, SolveClock::time_point::max());
+	return TSPAntColony(g, params, control);
+}
+
+std::vector<int> TSPAntColony(Graph& g, const ACOParams& params, SolveControl& control) {
+	int n = g.getSize();
+	if (n < 3)
+	{
+		std::vector<int> tour;
+		for (int i = 0; i < n; i++)
+		{
+			tour.push_back(i);
+		}
+		control.offer(toPath(tour));
+		return toPath(tour);
+	}
+	if (g.hasCoordinates())
+	{
+		//Point-backed graphs are the ones too big for one n*n matrix, let
+		//alone the three kept here; leave the tour to the other solvers.
+		return std::vector<int>();
+	}
+	int k = std::min(params.candidates, n - 1);
+	std::shared_ptr<const NeighbourLists> candidates = g.getNeighbours(k);
+	bool symmetric = isSymmetric(g);
+
+	//Flat n*n buffers laid out like the graph's matrix, so row i of eta,
+	//tau and choice sits at the same offset as row i of the weights.
+	MatrixBuffer eta;
+	eta.resize(size_t(n) * n);
+	parallelFor(n, [&](size_t i) {
+		const double* row = g.getRow(i);
+		double* out = eta.data() + i * n;
+		for (int j = 0; j < n; j++)
+		{
+			if (j != (int)i)
+			{
+				out[j] = std::pow(1.0 / std::max(row[j], 1e-9), params.beta);
+			}
+		}
+	});
+
+	std::vector<int> best = nearestNeighbourTour(g);
+	double best_length = tourLength(g, best);
+	control.offer(toPath(best), best_length);
+	double tau_max = 1.0 / (params.rho * best_length);
+	double tau_min = tau_max / (2.0 * n);
+	MatrixBuffer tau;
+	tau.resize(size_t(n) * n);
+	std::fill(tau.data(), tau.data() + size_t(n) * n, tau_max);
+	MatrixBuffer choice;
+	choice.resize(size_t(n) * n);
+	parallelFor(n, [&](size_t i) {
+		updateRow(tau.data() + i * n, eta.data() + i * n, choice.data() + i * n, n, 1.0, params.alpha, tau_min, tau_max);
+	});
+
+	double keep = 1.0 - params.rho;
+	SolverCounters counters;
+	std::vector< std::vector<int> > tours(params.ants);
+	std::vector<double> lengths(params.ants);
+	for (int it = 0; it < params.iterations && !control.shouldStop(); it++)
+	{
+		parallelFor(params.ants, [&](size_t a) {
+			CounterRng rng(params.seed, uint64_t(it) * params.ants + a);
+			tours[a] = constructTour(choice.data(), n, *candidates, k, rng);
+			lengths[a] = tourLength(g, tours[a]);
+		});
+		counters.evaluations += params.ants;
+		size_t iteration_best = std::min_element(lengths.begin(), lengths.end()) - lengths.begin();
+		if (lengths[iteration_best] < best_length)
+		{
+			best = tours[iteration_best];
+			best_length = lengths[iteration_best];
+			counters.improvements++;
+			control.offer(toPath(best), best_length);
+		}
+		tau_max = 1.0 / (params.rho * best_length);
+		tau_min = tau_max / (2.0 * n);
+
+		//Every tenth update comes from the best-so-far ant, the rest from
+		//the iteration best. The deposit is pre-divided by keep so that
+		//evaporation and clamping can run as one pass afterwards.
+		const std::vector<int>& deposit_tour = (it % 10 == 9) ? best : tours[iteration_best];
+		double deposit = 1.0 / (keep * tourLength(g, deposit_tour));
+		for (int i = 0; i < n; i++)
+		{
+			int a = deposit_tour[i];
+			int b = deposit_tour[(i + 1) % n];
+			tau[size_t(a) * n + b] += deposit;
+			if (symmetric)
+			{
+				tau[size_t(b) * n + a] += deposit;
+			}
+		}
+		parallelFor(n, [&](size_t i) {
+			updateRow(tau.data() + i * n, eta.data() + i * n, choice.data() + i * n, n, keep, params.alpha, tau_min, tau_max);
+		});
+	}
+	control.addCounters(counters);
+	return toPath(best);
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include "anytime.h"
+#include "graph.h"
+#include <vector>
+
+struct ACOParams
+{
+	int ants;
+	int iterations;
+	int candidates;
+	double alpha;
+	double beta;
+	double rho;
+	uint64_t seed;
+};
+
+ACOParams defaultACOParams(const Graph& g);
+//Max-Min Ant System. Pheromone is kept per directed edge, so asymmetric
+//matrices are handled as read. Returns a path starting at vertex 1, or an
+//empty one on a point-backed graph (see Graph::useCoordinates).
+std::vector<int> TSPAntColony(Graph& g, const ACOParams& params);
+std::vector<int> TSPAntColony(Graph& g, const ACOParams& params, SolveControl& control);
+std::vector<int> TSPAntColony(Graph& g);
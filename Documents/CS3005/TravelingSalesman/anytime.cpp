@@ -0,0 +1,173 @@
+#include "anytime.h"
+#include "gpx.h"
+#include "heuristics.h"
+#include "rng.h"
+#include "tabu.h"
+#include <algorithm>
+#include <limits>
+
+CancelToken::CancelToken()
+	:
+	mFlag(std::make_shared< std::atomic<bool> >(false)) {
+}
+void CancelToken::cancel() const {
+	mFlag->store(true);
+}
+bool CancelToken::isCancelled() const {
+	return mFlag->load(std::memory_order_relaxed);
+}
+
+SolveControl::SolveControl(Graph& g, SolveClock::time_point deadline, CancelToken token, ImproveCallback on_improve)
+	:
+	mGraph(g), mStart(SolveClock::now()), mDeadline(deadline), mToken(token), mOnImprove(on_improve),
+	mBestPath(), mBestWeight(std::numeric_limits<double>::max()), mCounters(), mTimeline() {
+}
+bool SolveControl::shouldStop() const {
+	return mToken.isCancelled() || SolveClock::now() >= mDeadline;
+}
+bool SolveControl::offer(const std::vector<int>& path) {
+	if (path.empty())
+	{
+		return false;
+	}
+	return offer(path, mGraph.getPathWeight(path));
+}
+bool SolveControl::offer(const std::vector<int>& path, double weight) {
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (path.empty() || weight >= mBestWeight)
+	{
+		return false;
+	}
+	mBestPath = path;
+	mBestWeight = weight;
+	ImprovementEvent event;
+	event.seconds = getElapsed();
+	event.weight = weight;
+	event.quality = mGraph.getQuality(weight);
+	event.strategy = currentStrategy();
+	mTimeline.push_back(event);
+	if (mOnImprove)
+	{
+		mOnImprove(mBestPath, mBestWeight, mGraph.getQuality(mBestWeight));
+	}
+	return true;
+}
+std::vector<int> SolveControl::getBestPath() const {
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mBestPath;
+}
+double SolveControl::getBestWeight() const {
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mBestWeight;
+}
+SolveClock::time_point SolveControl::getDeadline() const {
+	return mDeadline;
+}
+const CancelToken& SolveControl::getToken() const {
+	return mToken;
+}
+Graph& SolveControl::getGraph() const {
+	return mGraph;
+}
+double SolveControl::getElapsed() const {
+	return std::chrono::duration<double>(SolveClock::now() - mStart).count();
+}
+void SolveControl::addCounters(const SolverCounters& counters) {
+	std::lock_guard<std::mutex> lock(mMutex);
+	mCounters[currentStrategy()].add(counters);
+}
+std::map<std::string, SolverCounters> SolveControl::getCounters() const {
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mCounters;
+}
+std::vector<ImprovementEvent> SolveControl::getTimeline() const {
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mTimeline;
+}
+void SolveControl::absorb(const SolveControl& sub) {
+	std::map<std::string, SolverCounters> counters = sub.getCounters();
+	std::vector<ImprovementEvent> timeline = sub.getTimeline();
+	double offset = std::chrono::duration<double>(sub.mStart - mStart).count();
+	std::lock_guard<std::mutex> lock(mMutex);
+	SolverCounters& mine = mCounters[currentStrategy()];
+	for (std::map<std::string, SolverCounters>::const_iterator it = counters.begin(); it != counters.end(); ++it)
+	{
+		mine.add(it->second);
+	}
+	if (&sub.mGraph != &mGraph || timeline.empty())
+	{
+		return;
+	}
+	for (size_t i = 0; i < timeline.size(); i++)
+	{
+		timeline[i].seconds += offset;
+		timeline[i].strategy = currentStrategy();
+	}
+	timeline.insert(timeline.end(), mTimeline.begin(), mTimeline.end());
+	std::stable_sort(timeline.begin(), timeline.end(),
+		[](const ImprovementEvent& a, const ImprovementEvent& b) { return a.seconds < b.seconds; });
+	mTimeline.clear();
+	for (size_t i = 0; i < timeline.size(); i++)
+	{
+		if (mTimeline.empty() || timeline[i].weight < mTimeline.back().weight)
+		{
+			mTimeline.push_back(timeline[i]);
+		}
+	}
+}
+
+std::vector<int> solveAnytime(Graph& g, SolveControl& control) {
+	return resumeAnytime(g, control, NULL, StateCallback());
+}
+
+std::vector<int> resumeAnytime(Graph& g, SolveControl& control, const AnytimeState* from, StateCallback on_state) {
+	AnytimeState state;
+	state.restart = 0;
+	state.elapsed = 0.0;
+	if (from != NULL)
+	{
+		state = *from;
+		control.offer(from->bestPath);
+	}
+	else
+	{
+		CounterRng rng(taskRng().next(), 0);
+		state.rngKey = rng.getKey();
+		state.rngCounter = rng.getCounter();
+		control.offer(TSPNumericalOrder(g));
+		control.offer(TSPOddsEvens(g));
+		control.offer(TSPThrees(g));
+	}
+	double earlier = state.elapsed;
+	RngScope rng(CounterRng::fromState(state.rngKey, state.rngCounter));
+	TabuParams params = defaultTabuParams(g);
+	SolverCounters counters;
+	std::function<void()> report = [&]() {
+		if (on_state)
+		{
+			state.rngKey = rng.get().getKey();
+			state.rngCounter = rng.get().getCounter();
+			state.elapsed = earlier + control.getElapsed();
+			state.bestPath = control.getBestPath();
+			on_state(state);
+		}
+	};
+	while (!control.shouldStop())
+	{
+		counters.restarts++;
+		std::vector<int> path = TSPTabuSearch(g, params, control);
+		control.offer(partitionCrossover(g, control.getBestPath(), path));
+		state.restart++;
+		report();
+	}
+	//Also catches whatever other portfolio members offered after the last
+	//restart.
+	report();
+	control.addCounters(counters);
+	return control.getBestPath();
+}
+
+std::vector<int> solveWithin(Graph& g, std::chrono::milliseconds budget, CancelToken token, ImproveCallback on_improve) {
+	SolveControl control(g, SolveClock::now() + budget, token, on_improve);
+	return solveAnytime(g, control);
+}
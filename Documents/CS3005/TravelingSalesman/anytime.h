@@ -0,0 +1,88 @@
+#pragma once
+#include "graph.h"
+#include "telemetry.h"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+typedef std::chrono::steady_clock SolveClock;
+
+//Copies share one flag, so a token handed to a solve can be cancelled
+//from any thread.
+class CancelToken
+{
+public:
+	CancelToken();
+	void cancel() const;
+	bool isCancelled() const;
+private:
+	std::shared_ptr< std::atomic<bool> > mFlag;
+};
+
+typedef std::function<void(const std::vector<int>& path, double weight, double quality)> ImproveCallback;
+
+//Stopping rule and incumbent shared by everything taking part in one
+//solve. Solvers poll shouldStop() and offer() the tours they find; the
+//callback runs under the incumbent lock, in improvement order. Every
+//improvement is also kept on a timeline for telemetry.
+class SolveControl
+{
+public:
+	SolveControl(Graph& g, SolveClock::time_point deadline,
+		CancelToken token = CancelToken(), ImproveCallback on_improve = ImproveCallback());
+	bool shouldStop() const;
+	bool offer(const std::vector<int>& path);
+	bool offer(const std::vector<int>& path, double weight);
+	std::vector<int> getBestPath() const;
+	double getBestWeight() const;
+	SolveClock::time_point getDeadline() const;
+	const CancelToken& getToken() const;
+	Graph& getGraph() const;
+	double getElapsed() const;
+	void addCounters(const SolverCounters& counters);
+	std::map<std::string, SolverCounters> getCounters() const;
+	std::vector<ImprovementEvent> getTimeline() const;
+	//Folds a finished sub-solve's counters in under the calling thread's
+	//strategy. When it ran on the same graph its improvements join the
+	//timeline too, as long as they still improve on what came before.
+	void absorb(const SolveControl& sub);
+	SolveControl(const SolveControl&) = delete;
+	SolveControl& operator=(const SolveControl&) = delete;
+private:
+	Graph& mGraph;
+	SolveClock::time_point mStart;
+	SolveClock::time_point mDeadline;
+	CancelToken mToken;
+	ImproveCallback mOnImprove;
+	mutable std::mutex mMutex;
+	std::vector<int> mBestPath;
+	double mBestWeight;
+	std::map<std::string, SolverCounters> mCounters;
+	std::vector<ImprovementEvent> mTimeline;
+};
+
+//Seeds the incumbent with the fixed constructions, then keeps running
+//tabu restarts, merging each into the incumbent with partition crossover,
+//until the deadline passes or the token is cancelled.
+std::vector<int> solveAnytime(Graph& g, SolveControl& control);
+
+//Everything needed to pick a solveAnytime run back up.
+struct AnytimeState
+{
+	uint64_t restart;
+	uint64_t rngKey;
+	uint64_t rngCounter;
+	//Seconds of budget used, across all earlier runs.
+	double elapsed;
+	std::vector<int> bestPath;
+};
+typedef std::function<void(const AnytimeState& state)> StateCallback;
+//solveAnytime, continuing from `from` when it is given and reporting its
+//state to `on_state` after every restart and once more at the end.
+std::vector<int> resumeAnytime(Graph& g, SolveControl& control, const AnytimeState* from, StateCallback on_state);
+std::vector<int> solveWithin(Graph& g, std::chrono::milliseconds budget,
+	CancelToken token = CancelToken(), ImproveCallback on_improve = ImproveCallback());
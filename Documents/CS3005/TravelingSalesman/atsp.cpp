@@ -0,0 +1,234 @@
+#include "atsp.h"
+#include "rng.h"
+#include <algorithm>
+
+namespace {
+
+const int NEIGHBOURS = 8;
+const int MAX_SEGMENT = 3;
+const double EPSILON = 1e-9;
+
+//A tour as 0-based vertices with t[0] == 0 held in place, so segments
+//never wrap.
+class AsymmetricTour
+{
+public:
+	AsymmetricTour(const Graph& g, const std::vector<int>& tour)
+		:
+		mGraph(g), mTour(tour), mPosition(tour.size()) {
+		refresh(0, mTour.size() - 1);
+	}
+	bool improve(int i, const NeighbourLists& lists, SolverCounters& counters);
+	const std::vector<int>& getTour() const { return mTour; }
+private:
+	double w(int a, int b) const { return mGraph.getWeight(a, b); }
+	int at(int position) const { return mTour[position % mTour.size()]; }
+	bool tryInsertion(int i, const NeighbourLists& lists, SolverCounters& counters);
+	bool tryExchange(int i, const NeighbourLists& lists, SolverCounters& counters);
+	void refresh(int begin, int end);
+	const Graph& mGraph;
+	std::vector<int> mTour;
+	std::vector<int> mPosition;
+};
+
+//Only positions in the rotated range [begin, end] move.
+void AsymmetricTour::refresh(int begin, int end) {
+	for (int k = begin; k <= end; k++)
+	{
+		mPosition[mTour[k]] = k;
+	}
+}
+
+bool AsymmetricTour::improve(int i, const NeighbourLists& lists, SolverCounters& counters) {
+	return tryInsertion(i, lists, counters) || tryExchange(i, lists, counters);
+}
+
+//Moves t[i..i+len-1] between c and d, where d is a near successor of the
+//segment's last vertex.
+bool AsymmetricTour::tryInsertion(int i, const NeighbourLists& lists, SolverCounters& counters) {
+	int n = mTour.size();
+	for (int len = 1; len <= MAX_SEGMENT && i + len <= n; len++)
+	{
+		int first = mTour[i];
+		int last = mTour[i + len - 1];
+		int prev = mTour[i - 1];
+		int next = at(i + len);
+		double removal = w(prev, first) + w(last, next) - w(prev, next);
+		const int* near = lists.getIds(last);
+		for (int c = 0; c < std::min(NEIGHBOURS, lists.count); c++)
+		{
+			int q = mPosition[near[c]];
+			if (q == 0)
+			{
+				q = n;
+			}
+			if (q >= i && q <= i + len)
+			{
+				continue;
+			}
+			int before = mTour[q - 1];
+			int after = near[c];
+			counters.evaluations++;
+			double delta = w(before, first) + w(last, after) - w(before, after) - removal;
+			if (delta < -EPSILON)
+			{
+				if (q < i)
+				{
+					std::rotate(mTour.begin() + q, mTour.begin() + i, mTour.begin() + i + len);
+					refresh(q, i + len - 1);
+				}
+				else
+				{
+					std::rotate(mTour.begin() + i, mTour.begin() + i + len, mTour.begin() + q);
+					refresh(i, q - 1);
+				}
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+//Swaps t[i..p-1] and t[p..q-1], where t[p] is a near successor of t[i-1]
+//and t[q] a near successor of t[p-1].
+bool AsymmetricTour::tryExchange(int i, const NeighbourLists& lists, SolverCounters& counters) {
+	int n = mTour.size();
+	int a = mTour[i - 1];
+	const int* near_a = lists.getIds(a);
+	for (int x = 0; x < std::min(NEIGHBOURS, lists.count); x++)
+	{
+		int p = mPosition[near_a[x]];
+		if (p <= i)
+		{
+			continue;
+		}
+		int j = mTour[p - 1];
+		const int* near_j = lists.getIds(j);
+		for (int y = 0; y < std::min(NEIGHBOURS, lists.count); y++)
+		{
+			int q = mPosition[near_j[y]];
+			if (q == 0)
+			{
+				q = n;
+			}
+			if (q <= p)
+			{
+				continue;
+			}
+			int k = mTour[q - 1];
+			int b = at(q);
+			counters.evaluations++;
+			double delta = w(a, mTour[p]) + w(k, mTour[i]) + w(j, b)
+				- w(a, mTour[i]) - w(j, mTour[p]) - w(k, b);
+			if (delta < -EPSILON)
+			{
+				std::rotate(mTour.begin() + i, mTour.begin() + p, mTour.begin() + q);
+				refresh(i, q - 1);
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+//Once the control stops, the full-row fallback gives way to appending
+//every unvisited vertex in one pass, so the start is always a complete
+//tour.
+std::vector<int> nearestNeighbourStart(const Graph& g, const NeighbourLists& lists, int start, SolveControl& control) {
+	int n = g.getSize();
+	std::vector<char> visited(n, 0);
+	std::vector<int> tour;
+	tour.reserve(n);
+	int current = start;
+	visited[current] = 1;
+	tour.push_back(current);
+	for (int step = 1; step < n; step++)
+	{
+		int next = -1;
+		const int* near = lists.getIds(current);
+		for (int c = 0; c < lists.count && next < 0; c++)
+		{
+			if (!visited[near[c]])
+			{
+				next = near[c];
+			}
+		}
+		if (next < 0 && control.shouldStop())
+		{
+			for (int j = 0; j < n; j++)
+			{
+				if (!visited[j])
+				{
+					tour.push_back(j);
+				}
+			}
+			break;
+		}
+		if (next < 0)
+		{
+			const double* row = g.getRow(current);
+			for (int j = 0; j < n; j++)
+			{
+				if (!visited[j] && (next < 0 || row[j] < row[next]))
+				{
+					next = j;
+				}
+			}
+		}
+		visited[next] = 1;
+		tour.push_back(next);
+		current = next;
+	}
+	std::rotate(tour.begin(), std::find(tour.begin(), tour.end(), 0), tour.end());
+	return tour;
+}
+
+}
+
+std::vector<int> TSPAsymmetricSearch(Graph& g) {
+	SolveControl control(g, SolveClock::time_point::max());
+	return TSPAsymmetricSearch(g, control);
+}
+
+std::vector<int> TSPAsymmetricSearch(Graph& g, SolveControl& control) {
+	int n = g.getSize();
+	std::vector<int> path;
+	std::shared_ptr<const NeighbourLists> lists;
+	if (n >= 5)
+	{
+		lists = g.getNeighbours(NEIGHBOURS, [&control]() { return control.shouldStop(); });
+	}
+	//Too small for the moves, or stopped before the lists were ready.
+	if (!lists)
+	{
+		for (int i = 1; i <= n; i++)
+		{
+			path.push_back(i);
+		}
+		control.offer(path);
+		return path;
+	}
+	AsymmetricTour tour(g, nearestNeighbourStart(g, *lists, taskRng().below(n), control));
+	SolverCounters counters;
+	bool improved = true;
+	while (improved && !control.shouldStop())
+	{
+		improved = false;
+		for (int i = 1; i < n && !control.shouldStop(); i++)
+		{
+			while (tour.improve(i, *lists, counters))
+			{
+				counters.improvements++;
+				improved = true;
+			}
+		}
+	}
+	const std::vector<int>& best = tour.getTour();
+	for (int i = 0; i < n; i++)
+	{
+		path.push_back(best[i] + 1);
+	}
+	control.offer(path);
+	control.addCounters(counters);
+	return path;
+}
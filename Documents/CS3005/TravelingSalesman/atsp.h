@@ -0,0 +1,13 @@
+#pragma once
+#include "anytime.h"
+#include "graph.h"
+#include <vector>
+
+//Local search for asymmetric instances. Segment insertion (or-opt, up to
+//three vertices) and exchange of two adjacent segments (or-3opt) never
+//reverse anything, so their cost is O(1) to evaluate in either direction
+//and applying one only renumbers the rotated range. Move partners come
+//from the graph's shared neighbour lists. Starts from a nearest-neighbour
+//tour from a random vertex and descends until no move improves.
+std::vector<int> TSPAsymmetricSearch(Graph& g);
+std::vector<int> TSPAsymmetricSearch(Graph& g, SolveControl& control);
@@ -0,0 +1,167 @@
+#include "batch.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <dirent.h>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <sys/stat.h>
+#include <thread>
+
+namespace {
+
+bool isDirectory(const std::string& path) {
+	struct stat info;
+	return stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+bool isRegularFile(const std::string& path) {
+	struct stat info;
+	return stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode);
+}
+
+//Solves one input and returns everything that should be printed for it.
+std::string solveInput(const BatchInput& input, const SolveConfig& config, std::string* telemetry, bool& ok) {
+	std::ostringstream out;
+	out << input.label << '\n';
+	std::ifstream fin(input.path.c_str(), std::ios::binary);
+	Graph g;
+	std::string error = "cannot open file";
+	LoadOptions load = defaultLoadOptions();
+	load.quantise = config.quantise;
+	if (!fin || !loadGraph(fin, g, load, error))
+	{
+		out << "error: could not read graph from " << input.path << ": " << error << '\n';
+		ok = false;
+		return out.str();
+	}
+	if (!g.hasBounds())
+	{
+		g.setMaxWeight();
+		g.setMinWeight();
+	}
+	std::string json;
+	writeResult(out, g, solveWithConfig(g, config, telemetry != NULL ? &json : NULL));
+	if (telemetry != NULL)
+	{
+		*telemetry = "{\"input\":" + jsonString(input.label) + ",\"telemetry\":" + json + "}";
+	}
+	ok = true;
+	return out.str();
+}
+
+}
+
+void writeResult(std::ostream& out, const Graph& g, const std::vector<int>& path) {
+	for (size_t i = 0; i < path.size(); i++)
+	{
+		out << path[i] << ' ';
+	}
+	double weight = g.getExactPathWeight(path);
+	out << weight << ' ' << g.getQuality(weight) << std::endl;
+}
+
+std::vector<BatchInput> listBatchInputs(const std::string& source) {
+	std::vector<BatchInput> inputs;
+	if (isDirectory(source))
+	{
+		DIR* dir = opendir(source.c_str());
+		if (dir == NULL)
+		{
+			return inputs;
+		}
+		for (dirent* entry = readdir(dir); entry != NULL; entry = readdir(dir))
+		{
+			BatchInput input;
+			input.label = entry->d_name;
+			input.path = source + "/" + entry->d_name;
+			if (isRegularFile(input.path))
+			{
+				inputs.push_back(input);
+			}
+		}
+		closedir(dir);
+		std::sort(inputs.begin(), inputs.end(),
+			[](const BatchInput& a, const BatchInput& b) { return a.label < b.label; });
+		return inputs;
+	}
+	std::ifstream manifest(source.c_str());
+	std::string line;
+	while (std::getline(manifest, line))
+	{
+		line.erase(line.find_last_not_of(" \t\r") + 1);
+		if (line.empty() || line[0] == '#')
+		{
+			continue;
+		}
+		BatchInput input;
+		input.label = line;
+		input.path = line;
+		inputs.push_back(input);
+	}
+	return inputs;
+}
+
+int runBatch(const std::vector<BatchInput>& inputs, std::ostream& out, unsigned threads, const SolveConfig& config,
+	std::ostream* telemetry) {
+	size_t count = inputs.size();
+	std::vector<std::string> results(count);
+	std::vector<std::string> telemetry_lines(count);
+	std::vector<char> ready(count, 0);
+	std::vector<char> ok(count, 0);
+	std::atomic<size_t> next(0);
+	std::mutex mutex;
+	std::condition_variable done;
+
+	//Workers take the next unclaimed input, so one slow graph does not hold
+	//up the others.
+	std::vector<std::thread> workers;
+	for (unsigned w = 0; w < std::max(1u, threads) && w < count; w++)
+	{
+		workers.push_back(std::thread([&]() {
+			for (size_t i = next++; i < count; i = next++)
+			{
+				bool solved = false;
+				std::string json;
+				std::string result = solveInput(inputs[i], config, telemetry != NULL ? &json : NULL, solved);
+				std::lock_guard<std::mutex> lock(mutex);
+				results[i].swap(result);
+				telemetry_lines[i].swap(json);
+				ok[i] = solved;
+				ready[i] = 1;
+				done.notify_all();
+			}
+		}));
+	}
+
+	int status = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		std::string result, json;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			while (!ready[i])
+			{
+				done.wait(lock);
+			}
+			result.swap(results[i]);
+			json.swap(telemetry_lines[i]);
+			if (!ok[i])
+			{
+				status = 1;
+			}
+		}
+		out << result;
+		out.flush();
+		if (telemetry != NULL && !json.empty())
+		{
+			*telemetry << json << std::endl;
+		}
+	}
+	for (size_t w = 0; w < workers.size(); w++)
+	{
+		workers[w].join();
+	}
+	return status;
+}
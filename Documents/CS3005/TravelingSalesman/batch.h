@@ -0,0 +1,28 @@
+#pragma once
+#include "graph.h"
+#include "parallel.h"
+#include "registry.h"
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct BatchInput
+{
+	std::string label;
+	std::string path;
+};
+
+//Prints a tour in the "path weight quality" line format, with the exact
+//weight when the graph is quantised.
+void writeResult(std::ostream& out, const Graph& g, const std::vector<int>& path);
+//A directory yields every regular file in it, sorted by name; anything
+//else is read as a manifest with one graph path per line. Blank lines and
+//lines starting with '#' are skipped.
+std::vector<BatchInput> listBatchInputs(const std::string& source);
+//Loads and solves the inputs across `threads` workers. Results are
+//streamed as soon as every earlier input has been written, each as its
+//label followed by the result line. If `telemetry` is given, one JSON
+//line per input goes there in the same order. Returns non-zero if any
+//input failed.
+int runBatch(const std::vector<BatchInput>& inputs, std::ostream& out, unsigned threads, const SolveConfig& config,
+	std::ostream* telemetry = NULL);
@@ -0,0 +1,332 @@
+#include "dynamic.h"
+#include "graph.h"
+#include "heuristics.h"
+#include "matrix.h"
+#include "registry.h"
+#include "relabel.h"
+#include "rng.h"
+#include "tabu.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//Benchmarks for the TravelingSalesman solvers. Every result is printed as
+//"instance<TAB>metric<TAB>value" with fixed seeds and fixed metric names so
+//runs on different commits can be diffed line by line.
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double secondsSince(Clock::time_point start) {
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void report(const std::string& instance, const std::string& metric, double value) {
+	std::cout << instance << '\t' << metric << '\t' << value << std::endl;
+}
+
+//Uniform points in a 1000x1000 square, written out in the text format,
+//or as "coords n" points when `points` is set.
+std::string generateText(int n, unsigned seed, bool points) {
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<double> coord(0.0, 1000.0);
+	std::vector<double> x(n), y(n);
+	for (int i = 0; i < n; i++)
+	{
+		x[i] = coord(rng);
+		y[i] = coord(rng);
+	}
+	std::ostringstream out;
+	if (points)
+	{
+		out << "coords " << n << '\n';
+		out.precision(17);
+		for (int i = 0; i < n; i++)
+		{
+			out << i + 1 << ' ' << x[i] << ' ' << y[i] << '\n';
+		}
+		return out.str();
+	}
+	out << n << '\n';
+	for (int i = 0; i < n; i++)
+	{
+		for (int j = 0; j < n; j++)
+		{
+			if (i != j)
+			{
+				out << i + 1 << ' ' << j + 1 << ' ' << std::hypot(x[i] - x[j], y[i] - y[j]) << '\n';
+			}
+		}
+	}
+	return out.str();
+}
+
+//Repeats fn until at least `seconds` have passed; returns calls per second.
+template <typename F>
+double throughput(F fn, double seconds) {
+	Clock::time_point start = Clock::now();
+	long calls = 0;
+	double elapsed = 0.0;
+	do
+	{
+		for (int i = 0; i < 64; i++)
+		{
+			fn();
+		}
+		calls += 64;
+		elapsed = secondsSince(start);
+	} while (elapsed < seconds);
+	return calls / elapsed;
+}
+
+volatile double gSink;
+
+void benchEvaluation(const std::string& name, Graph& g) {
+	RngScope scope(1, 0);
+	std::vector<int> path = getRandomCycle(g);
+	double tours = throughput([&]() { gSink = g.getPathWeight(path); }, 0.2);
+	report(name, "tour_evals_per_sec", tours);
+	report(name, "ns_per_edge", 1e9 / (tours * g.getSize()));
+
+	std::mt19937 rng(2);
+	std::uniform_int_distribution<int> position(1, g.getSize() - 1);
+	double moves = throughput([&]() {
+		int x = position(rng);
+		int y = position(rng);
+		if (x != y)
+		{
+			gSink = getSwapDelta(g, path, x, y);
+		}
+	}, 0.2);
+	report(name, "swap_deltas_per_sec", moves);
+}
+
+//Evaluates the same nearest-neighbour tour on the graph as given and on
+//the graph renumbered along it. Only run with --locality: the relabelled
+//walk came out slower at n=1000 (2.53 vs 2.17 ns/edge) and only 9% and 1%
+//faster at n=4000 and 8000, so it is not part of the default comparison.
+void benchLocality(const std::string& name, Graph& g) {
+	std::vector<int> order = getLocalityOrder(g);
+	Graph relabelled = relabelGraph(g, order);
+	std::vector<int> identity(order.size());
+	for (size_t i = 0; i < identity.size(); i++)
+	{
+		identity[i] = i + 1;
+	}
+	std::vector<int> original = restoreLabels(identity, order);
+	double before = throughput([&]() { gSink = g.getPathWeight(original); }, 0.2);
+	double after = throughput([&]() { gSink = relabelled.getPathWeight(identity); }, 0.2);
+	report(name, "relabel.ns_per_edge_original", 1e9 / (before * g.getSize()));
+	report(name, "relabel.ns_per_edge_relabelled", 1e9 / (after * g.getSize()));
+}
+
+//A solver that runs more than a tenth past the budget is flagged with
+//.overran, since its time-to-quality numbers are not comparable, and one
+//that declines the instance (aco on points) with .no_tour.
+void benchSolvers(const std::string& name, Graph& g, long budget) {
+	const double marks[] = { 0.001, 0.01, 0.1, 1.0, 10.0 };
+	const std::vector<SolverEntry>& entries = SolverRegistry::instance().getEntries();
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		RngScope rng(1, 0);
+		SolveControl control(g, Clock::now() + std::chrono::milliseconds(budget));
+		{
+			StrategyScope scope(entries[i].name);
+			entries[i].solve(g, control);
+		}
+		double elapsed = control.getElapsed();
+		std::vector<ImprovementEvent> timeline = control.getTimeline();
+		if (timeline.empty())
+		{
+			report(name, entries[i].name + ".no_tour", 1.0);
+			continue;
+		}
+		report(name, entries[i].name + ".seconds", elapsed);
+		report(name, entries[i].name + ".overran", elapsed > budget * 1.1e-3 ? 1.0 : 0.0);
+		report(name, entries[i].name + ".quality", g.getQuality(control.getBestWeight()));
+		for (size_t m = 0; m < sizeof(marks) / sizeof(marks[0]) && marks[m] * 1000.0 <= budget; m++)
+		{
+			double quality = 0.0;
+			for (size_t e = 0; e < timeline.size() && timeline[e].seconds <= marks[m]; e++)
+			{
+				quality = timeline[e].quality;
+			}
+			std::ostringstream metric;
+			metric << entries[i].name << ".quality@" << marks[m] * 1000.0 << "ms";
+			report(name, metric.str(), quality);
+		}
+	}
+}
+
+//Tour evaluation on the 16-bit copy, and how far its weights drift from
+//the exact ones.
+void benchQuantised(const std::string& name, Graph& g) {
+	Graph quantised;
+	std::string error;
+	if (!quantised.quantiseFrom(g, error))
+	{
+		std::cerr << name << ": " << error << std::endl;
+		return;
+	}
+	RngScope rng(1, 0);
+	std::vector<int> path = getRandomCycle(g);
+	double tours = throughput([&]() { gSink = quantised.getPathWeight(path); }, 0.2);
+	report(name, "quantised.ns_per_edge", 1e9 / (tours * g.getSize()));
+	report(name, "quantised.tour_error", std::fabs(quantised.getPathWeight(path) - g.getPathWeight(path)));
+	report(name, "quantised.tour_error_bound", quantised.getQuantisationError() * g.getSize());
+}
+
+//Raises ten edges of a tabu tour to three times their weight, in both
+//directions, and times the incremental repair. Leaves the graph changed.
+void benchDynamic(const std::string& name, Graph& g) {
+	RngScope rng(1, 0);
+	std::vector<int> path = TSPTabuSearch(g);
+	DynamicTour tour(g, path);
+	std::vector<WeightUpdate> updates;
+	for (int i = 0; i < 10; i++)
+	{
+		int from = path[taskRng().below(path.size())] - 1;
+		int to = path[(std::find(path.begin(), path.end(), from + 1) - path.begin() + 1) % path.size()] - 1;
+		WeightUpdate there = { from, to, g.getWeight(from, to) * 3.0 };
+		WeightUpdate back = { to, from, g.getWeight(to, from) * 3.0 };
+		updates.push_back(there);
+		updates.push_back(back);
+	}
+	double before = g.getPathWeight(path);
+	Clock::time_point start = Clock::now();
+	tour.update(updates);
+	report(name, "dynamic.update_seconds", secondsSince(start));
+	report(name, "dynamic.unrepaired_weight", g.getPathWeight(path));
+	report(name, "dynamic.repaired_weight", tour.getWeight());
+	report(name, "dynamic.weight_before", before);
+}
+
+void benchInstance(const std::string& name, const std::string& text, long budget, bool locality) {
+	Clock::time_point start = Clock::now();
+	std::istringstream in(text);
+	Graph g;
+	std::string error;
+	if (!loadGraph(in, g, defaultLoadOptions(), error))
+	{
+		std::cerr << name << ": " << error << std::endl;
+		return;
+	}
+	g.setMaxWeight();
+	g.setMinWeight();
+	report(name, "parse_seconds", secondsSince(start));
+	report(name, "parse_mb_per_sec", text.size() / 1e6 / secondsSince(start));
+	benchEvaluation(name, g);
+	//Relabelling, quantising and edge updates all need the matrix.
+	if (g.hasCoordinates())
+	{
+		benchSolvers(name, g, budget);
+		return;
+	}
+	if (locality)
+	{
+		benchLocality(name, g);
+	}
+	benchQuantised(name, g);
+	benchSolvers(name, g, budget);
+	benchDynamic(name, g);
+}
+
+int usage() {
+	std::cerr << "usage: TSP-bench [--budget ms] [--sizes n,n,...] [--max-matrix-mb mb] [--locality]" << std::endl;
+	std::cerr << "                 [--matrix-memory default|huge|interleave] [graph.txt...]" << std::endl;
+	return 1;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+	long budget = 500;
+	long max_matrix_mb = 1024;
+	bool locality = false;
+	std::vector<int> sizes;
+	sizes.push_back(100);
+	sizes.push_back(1000);
+	sizes.push_back(2000);
+	sizes.push_back(100000);
+	std::vector<std::string> files;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool has_value = i + 1 < argc;
+		if (arg == "--budget" && has_value)
+		{
+			budget = std::atol(argv[++i]);
+		}
+		else if (arg == "--max-matrix-mb" && has_value)
+		{
+			max_matrix_mb = std::atol(argv[++i]);
+		}
+		else if (arg == "--locality")
+		{
+			locality = true;
+		}
+		else if (arg == "--matrix-memory" && has_value)
+		{
+			MatrixPlacement placement;
+			if (!parseMatrixPlacement(argv[++i], placement))
+			{
+				return usage();
+			}
+			setMatrixPlacement(placement);
+		}
+		else if (arg == "--sizes" && has_value)
+		{
+			sizes.clear();
+			std::istringstream list(argv[++i]);
+			std::string size;
+			while (std::getline(list, size, ','))
+			{
+				sizes.push_back(std::atoi(size.c_str()));
+			}
+		}
+		else if (arg.compare(0, 2, "--") == 0)
+		{
+			return usage();
+		}
+		else
+		{
+			files.push_back(arg);
+		}
+	}
+	//Instances whose matrix would not fit keep only their points.
+	setMatrixLimit(size_t(max_matrix_mb) * 1000 * 1000);
+
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		std::ifstream fin(files[i].c_str());
+		std::stringstream text;
+		text << fin.rdbuf();
+		benchInstance(files[i], text.str(), budget, locality);
+	}
+	for (size_t i = 0; i < sizes.size(); i++)
+	{
+		std::ostringstream name;
+		name << "uniform" << sizes[i];
+		if (sizes[i] < 3)
+		{
+			report(name.str(), "skipped_size", sizes[i]);
+			continue;
+		}
+		double matrix_mb = double(sizes[i]) * sizes[i] * sizeof(double) / 1e6;
+		bool points = matrix_mb > max_matrix_mb;
+		if (points)
+		{
+			name << ".points";
+		}
+		benchInstance(name.str(), generateText(sizes[i], sizes[i], points), budget, locality);
+	}
+	return 0;
+}
@@ -0,0 +1,139 @@
+#include "checkpoint.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+const char CHECKPOINT_MAGIC[4] = { 'T', 'S', 'P', 'C' };
+const uint32_t CHECKPOINT_VERSION = 1;
+
+struct CheckpointHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint64_t fingerprint;
+	uint64_t restart;
+	uint64_t rngKey;
+	uint64_t rngCounter;
+	double elapsed;
+	uint64_t size;
+};
+
+}
+
+bool readCheckpoint(const std::string& path, const Graph& g, uint64_t fingerprint, AnytimeState& state) {
+	std::ifstream in(path.c_str(), std::ios::binary);
+	CheckpointHeader header;
+	if (!in.read((char*)&header, sizeof(header)))
+	{
+		return false;
+	}
+	if (std::memcmp(header.magic, CHECKPOINT_MAGIC, 4) != 0 || header.version != CHECKPOINT_VERSION
+		|| header.fingerprint != fingerprint || header.size != uint64_t(g.getSize()))
+	{
+		return false;
+	}
+	std::vector<uint32_t> tour(header.size);
+	if (!in.read((char*)tour.data(), tour.size() * sizeof(uint32_t)))
+	{
+		return false;
+	}
+	std::vector<char> seen(tour.size() + 1, 0);
+	for (size_t i = 0; i < tour.size(); i++)
+	{
+		if (tour[i] < 1 || tour[i] > tour.size() || seen[tour[i]])
+		{
+			return false;
+		}
+		seen[tour[i]] = 1;
+	}
+	state.restart = header.restart;
+	state.rngKey = header.rngKey;
+	state.rngCounter = header.rngCounter;
+	state.elapsed = header.elapsed;
+	state.bestPath.assign(tour.begin(), tour.end());
+	return true;
+}
+
+bool writeCheckpoint(const std::string& path, uint64_t fingerprint, const AnytimeState& state) {
+	CheckpointHeader header;
+	std::memcpy(header.magic, CHECKPOINT_MAGIC, 4);
+	header.version = CHECKPOINT_VERSION;
+	header.fingerprint = fingerprint;
+	header.restart = state.restart;
+	header.rngKey = state.rngKey;
+	header.rngCounter = state.rngCounter;
+	header.elapsed = state.elapsed;
+	header.size = state.bestPath.size();
+	std::vector<uint32_t> tour(state.bestPath.begin(), state.bestPath.end());
+	std::string temp = path + ".tmp";
+	{
+		std::ofstream out(temp.c_str(), std::ios::binary | std::ios::trunc);
+		out.write((const char*)&header, sizeof(header));
+		out.write((const char*)tour.data(), tour.size() * sizeof(uint32_t));
+		if (!out.flush())
+		{
+			return false;
+		}
+	}
+	return std::rename(temp.c_str(), path.c_str()) == 0;
+}
+
+CheckpointWriter::CheckpointWriter(const std::string& path, uint64_t fingerprint, double interval)
+	:
+	mPath(path), mFingerprint(fingerprint), mInterval(interval), mHasPending(false), mStopping(false) {
+	mThread = std::thread(&CheckpointWriter::run, this);
+}
+
+CheckpointWriter::~CheckpointWriter() {
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStopping = true;
+	}
+	mWake.notify_one();
+	mThread.join();
+}
+
+void CheckpointWriter::submit(const AnytimeState& state) {
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mPending = state;
+		mHasPending = true;
+	}
+	mWake.notify_one();
+}
+
+void CheckpointWriter::run() {
+	SolveClock::time_point next_write = SolveClock::now();
+	std::unique_lock<std::mutex> lock(mMutex);
+	while (true)
+	{
+		if (mHasPending && (mStopping || SolveClock::now() >= next_write))
+		{
+			AnytimeState state = mPending;
+			mHasPending = false;
+			lock.unlock();
+			if (!writeCheckpoint(mPath, mFingerprint, state))
+			{
+				std::cerr << "could not write checkpoint " << mPath << std::endl;
+			}
+			next_write = SolveClock::now() + std::chrono::duration_cast<SolveClock::duration>(std::chrono::duration<double>(mInterval));
+			lock.lock();
+			continue;
+		}
+		if (mStopping)
+		{
+			return;
+		}
+		if (mHasPending)
+		{
+			mWake.wait_until(lock, next_write);
+		}
+		else
+		{
+			mWake.wait(lock);
+		}
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "anytime.h"
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+//Checkpoint files: magic "TSPC", a version, the fingerprint of the graph
+//they belong to, then the AnytimeState with the tour as uint32s. A file
+//is only read back if its fingerprint matches and its tour is a
+//permutation of g's vertices.
+bool readCheckpoint(const std::string& path, const Graph& g, uint64_t fingerprint, AnytimeState& state);
+//Writes to path.tmp and renames it over path, so a crash mid-write keeps
+//the previous checkpoint.
+bool writeCheckpoint(const std::string& path, uint64_t fingerprint, const AnytimeState& state);
+
+//Writes checkpoints off the search thread. submit() only swaps in the
+//latest state; the writer thread saves it at most once per interval and
+//the destructor flushes whatever is still pending.
+class CheckpointWriter
+{
+public:
+	CheckpointWriter(const std::string& path, uint64_t fingerprint, double interval);
+	~CheckpointWriter();
+	void submit(const AnytimeState& state);
+	CheckpointWriter(const CheckpointWriter&) = delete;
+	CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+private:
+	void run();
+	std::string mPath;
+	uint64_t mFingerprint;
+	double mInterval;
+	std::mutex mMutex;
+	std::condition_variable mWake;
+	AnytimeState mPending;
+	bool mHasPending;
+	bool mStopping;
+	std::thread mThread;
+};
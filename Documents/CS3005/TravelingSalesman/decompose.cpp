@@ -0,0 +1,276 @@
+#include "decompose.h"
+#include "heuristics.h"
+#include "parallel.h"
+#include "rng.h"
+#include "tabu.h"
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+//Farthest-first seeding followed by a few rounds of assign / re-centre.
+//Graph carries no coordinates, so the medoid of a cluster stands in for
+//its mean. May return fewer than k clusters, never an empty one: seeding
+//stops once every vertex is at distance zero from a seed, and clusters
+//that lose all their members are dropped. Seeding assigns every vertex to
+//its nearest seed as it goes; seeding and refinement both end early once
+//the control stops.
+std::vector< std::vector<int> > partition(const Graph& g, int k, int rounds, const SolveControl& control) {
+	int n = g.getSize();
+	std::vector<int> medoids;
+	std::vector<double> nearest(n, std::numeric_limits<double>::max());
+	std::vector<int> owner(n, 0);
+	int seed = 0;
+	for (int c = 0; c < k && (c == 0 || !control.shouldStop()); c++)
+	{
+		medoids.push_back(seed);
+		const double* row = g.getRow(seed);
+		nearest[seed] = 0.0;
+		owner[seed] = c;
+		int farthest = 0;
+		for (int v = 0; v < n; v++)
+		{
+			if (row[v] < nearest[v])
+			{
+				nearest[v] = row[v];
+				owner[v] = c;
+			}
+			if (nearest[v] > nearest[farthest])
+			{
+				farthest = v;
+			}
+		}
+		if (nearest[farthest] <= 0.0)
+		{
+			//The rest coincide with seeds already taken.
+			break;
+		}
+		seed = farthest;
+	}
+	k = medoids.size();
+
+	std::vector< std::vector<int> > clusters;
+	for (int round = 0; ; round++)
+	{
+		clusters.assign(k, std::vector<int>());
+		for (int v = 0; v < n; v++)
+		{
+			clusters[owner[v]].push_back(v);
+		}
+		if (round == rounds || control.shouldStop())
+		{
+			break;
+		}
+		parallelFor(k, [&](size_t c) {
+			//An empty cluster keeps its medoid.
+			const std::vector<int>& members = clusters[c];
+			double best_cost = std::numeric_limits<double>::max();
+			for (size_t i = 0; i < members.size(); i++)
+			{
+				double cost = 0.0;
+				for (size_t j = 0; j < members.size(); j++)
+				{
+					cost += g.getWeight(members[i], members[j]);
+				}
+				if (cost < best_cost)
+				{
+					best_cost = cost;
+					medoids[c] = members[i];
+				}
+			}
+		});
+		parallelFor(n, [&](size_t v) {
+			int best = 0;
+			double best_weight = g.getWeight(medoids[0], v);
+			for (int c = 1; c < k; c++)
+			{
+				double weight = g.getWeight(medoids[c], v);
+				if (weight < best_weight)
+				{
+					best = c;
+					best_weight = weight;
+				}
+			}
+			owner[v] = best;
+		});
+	}
+	clusters.erase(std::remove_if(clusters.begin(), clusters.end(),
+		[](const std::vector<int>& members) { return members.empty(); }), clusters.end());
+	return clusters;
+}
+
+//Solves one cluster on its own sub-matrix. Returns 0-based global ids.
+std::vector<int> solveCluster(const Graph& g, const std::vector<int>& members,
+	const DecomposeParams& params, SolveControl& control) {
+	int m = members.size();
+	if (m < 3 || control.shouldStop())
+	{
+		return members;
+	}
+	Graph sub;
+	sub.setSize(m);
+	std::vector<double> edges(m);
+	for (int i = 0; i < m; i++)
+	{
+		for (int j = 0; j < m; j++)
+		{
+			edges[j] = g.getWeight(members[i], members[j]);
+		}
+		sub.pushBack(edges, i + 1);
+	}
+	sub.setMaxWeight();
+	sub.setMinWeight();
+	SolveControl sub_control(sub, control.getDeadline(), control.getToken());
+	std::vector<int> local = params.solver(sub, sub_control);
+	control.absorb(sub_control);
+	std::vector<int> tour;
+	for (size_t i = 0; i < local.size(); i++)
+	{
+		tour.push_back(members[local[i] - 1]);
+	}
+	return tour;
+}
+
+//Order clusters by a nearest-neighbour walk over their first vertices,
+//starting from the cluster that holds vertex 1. Empty tours are left out.
+std::vector<int> clusterOrder(const Graph& g, const std::vector< std::vector<int> >& tours) {
+	int k = tours.size();
+	std::vector<int> order;
+	std::vector<char> used(k, 0);
+	int current = -1;
+	for (int c = 0; c < k; c++)
+	{
+		if (tours[c].empty())
+		{
+			used[c] = 1;
+		}
+		else if (std::find(tours[c].begin(), tours[c].end(), 0) != tours[c].end())
+		{
+			current = c;
+		}
+	}
+	while (current >= 0)
+	{
+		order.push_back(current);
+		used[current] = 1;
+		int next = -1;
+		for (int c = 0; c < k; c++)
+		{
+			if (!used[c] && (next < 0 ||
+				g.getWeight(tours[current][0], tours[c][0]) < g.getWeight(tours[current][0], tours[next][0])))
+			{
+				next = c;
+			}
+		}
+		current = next;
+	}
+	return order;
+}
+
+//First-improvement swaps restricted to positions [begin, end).
+void polishWindow(const Graph& g, std::vector<int>& path, int begin, int end) {
+	bool improved = true;
+	while (improved)
+	{
+		improved = false;
+		for (int x = begin; x < end; x++)
+		{
+			for (int y = x + 1; y < end; y++)
+			{
+				if (getSwapDelta(g, path, x, y) < -1e-9)
+				{
+					std::swap(path[x], path[y]);
+					improved = true;
+				}
+			}
+		}
+	}
+}
+
+}
+
+DecomposeParams defaultDecomposeParams() {
+	DecomposeParams params;
+	params.clusterSize = 100;
+	params.refineRounds = 3;
+	params.window = 8;
+	params.solver = [](Graph& sub, SolveControl& control) {
+		return TSPTabuSearch(sub, defaultTabuParams(sub), control);
+	};
+	return params;
+}
+
+std::vector<int> TSPDecompose(Graph& g) {
+	return TSPDecompose(g, defaultDecomposeParams());
+}
+
+std::vector<int> TSPDecompose(Graph& g, const DecomposeParams& params) {
+	SolveControl control(g, SolveClock::time_point::max());
+	return TSPDecompose(g, params, control);
+}
+
+std::vector<int> TSPDecompose(Graph& g, const DecomposeParams& params, SolveControl& control) {
+	int n = g.getSize();
+	if (n <= params.clusterSize)
+	{
+		return params.solver(g, control);
+	}
+	int k = (n + params.clusterSize - 1) / params.clusterSize;
+	std::vector< std::vector<int> > clusters = partition(g, k, params.refineRounds, control);
+	k = clusters.size();
+
+	std::vector< std::vector<int> > tours(k);
+	uint64_t seed = taskRng().next();
+	parallelFor(k, [&](size_t c) {
+		RngScope scope(seed, c);
+		tours[c] = solveCluster(g, clusters[c], params, control);
+	});
+
+	//Stitch: enter each cluster tour at the vertex closest to where the
+	//previous one left off and walk it round once.
+	std::vector<int> order = clusterOrder(g, tours);
+	std::vector<int> path;
+	std::vector<int> seams;
+	path.reserve(n);
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		const std::vector<int>& tour = tours[order[i]];
+		if (tour.empty())
+		{
+			continue;
+		}
+		size_t entry = 0;
+		if (i == 0)
+		{
+			entry = std::find(tour.begin(), tour.end(), 0) - tour.begin();
+		}
+		else
+		{
+			int last = path.back() - 1;
+			for (size_t j = 1; j < tour.size(); j++)
+			{
+				if (g.getWeight(last, tour[j]) < g.getWeight(last, tour[entry]))
+				{
+					entry = j;
+				}
+			}
+			seams.push_back(path.size());
+		}
+		for (size_t j = 0; j < tour.size(); j++)
+		{
+			path.push_back(tour[(entry + j) % tour.size()] + 1);
+		}
+	}
+
+	//Polish across the seams, including the one closing the cycle. Vertex
+	//1 sits at position 0 and is left there.
+	seams.push_back(n);
+	for (size_t i = 0; i < seams.size(); i++)
+	{
+		int begin = std::max(1, seams[i] - params.window);
+		int end = std::min(n, seams[i] + params.window);
+		polishWindow(g, path, begin, end);
+	}
+	control.offer(path);
+	return path;
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include "anytime.h"
+#include "graph.h"
+#include <functional>
+#include <vector>
+
+struct DecomposeParams
+{
+	int clusterSize;
+	int refineRounds;
+	int window;
+	//Runs on a cluster's own graph under a control sharing the caller's
+	//deadline and token.
+	std::function<std::vector<int>(Graph&, SolveControl&)> solver;
+};
+
+DecomposeParams defaultDecomposeParams();
+//Splits the vertices into k-medoid clusters of roughly clusterSize,
+//solves every cluster concurrently with params.solver, chains the cluster
+//tours in medoid order and then swap-polishes `window` positions either
+//side of each seam. Clusters reached after the control stops keep their
+//members in order; the stitched tour is offered to the control.
+std::vector<int> TSPDecompose(Graph& g, const DecomposeParams& params, SolveControl& control);
+std::vector<int> TSPDecompose(Graph& g, const DecomposeParams& params);
+std::vector<int> TSPDecompose(Graph& g);
@@ -0,0 +1,258 @@
+#include "dynamic.h"
+#include <algorithm>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+//Tour positions on either side of a vertex tried as insertion points, on
+//top of the other ends of its changed edges.
+const int WINDOW = 6;
+//Nearest neighbours of a vertex tried as insertion points as well.
+const int NEIGHBOURS = 5;
+const double EPSILON = 1e-9;
+
+}
+
+DynamicTour::DynamicTour(Graph& g, const std::vector<int>& path)
+	:
+	mGraph(g), mNext(path.size()), mPrev(path.size()), mPath(path), mPathStale(false),
+	mWeight(g.getPathWeight(path)) {
+	int n = path.size();
+	for (int i = 0; i < n; i++)
+	{
+		mNext[path[i] - 1] = path[(i + 1) % n] - 1;
+		mPrev[path[(i + 1) % n] - 1] = path[i] - 1;
+	}
+	//Build the lists now rather than on the first update.
+	g.getNeighbours(NEIGHBOURS);
+}
+
+const std::vector<int>& DynamicTour::getPath() const {
+	if (mPathStale && !mPath.empty())
+	{
+		int vertex = mPath[0] - 1;
+		for (size_t i = 0; i < mPath.size(); i++)
+		{
+			mPath[i] = vertex + 1;
+			vertex = mNext[vertex];
+		}
+		mPathStale = false;
+	}
+	return mPath;
+}
+
+double DynamicTour::getWeight() const {
+	return mWeight;
+}
+
+int DynamicTour::getPrev(int vertex) const {
+	return mPrev[vertex];
+}
+
+int DynamicTour::getNext(int vertex) const {
+	return mNext[vertex];
+}
+
+double DynamicTour::weight(int from, int to) const {
+	return mGraph.getWeight(from, to);
+}
+
+void DynamicTour::update(const std::vector<WeightUpdate>& updates) {
+	std::unordered_map< int, std::vector<int> > partners;
+	std::deque<int> queue;
+	std::unordered_set<int> queued;
+	for (size_t i = 0; i < updates.size(); i++)
+	{
+		const WeightUpdate& u = updates[i];
+		if (getNext(u.from) == u.to)
+		{
+			mWeight += u.weight - weight(u.from, u.to);
+		}
+		mGraph.setWeight(u.from, u.to, u.weight);
+		partners[u.from].push_back(u.to);
+		partners[u.to].push_back(u.from);
+		if (queued.insert(u.from).second)
+		{
+			queue.push_back(u.from);
+		}
+		if (queued.insert(u.to).second)
+		{
+			queue.push_back(u.to);
+		}
+	}
+	std::shared_ptr<const NeighbourLists> lists = mGraph.getNeighbours(NEIGHBOURS);
+	std::vector<int> none, touched;
+	while (!queue.empty())
+	{
+		int vertex = queue.front();
+		queue.pop_front();
+		queued.erase(vertex);
+		std::unordered_map< int, std::vector<int> >::const_iterator found = partners.find(vertex);
+		touched.clear();
+		if (!improveVertex(vertex, found == partners.end() ? none : found->second, *lists, touched))
+		{
+			continue;
+		}
+		for (size_t i = 0; i < touched.size(); i++)
+		{
+			if (queued.insert(touched[i]).second)
+			{
+				queue.push_back(touched[i]);
+			}
+		}
+	}
+}
+
+//Applies the best relocation or swap of `vertex` against its candidates,
+//if any improves the tour, and lists the vertices whose edges changed.
+bool DynamicTour::improveVertex(int vertex, const std::vector<int>& partners, const NeighbourLists& lists,
+	std::vector<int>& touched) {
+	int n = mPath.size();
+	if (vertex == 0 || n < 4)
+	{
+		return false;
+	}
+	std::vector<int> candidates;
+	for (size_t i = 0; i < partners.size(); i++)
+	{
+		candidates.push_back(partners[i]);
+		candidates.push_back(getPrev(partners[i]));
+	}
+	const int* nearest = lists.getIds(vertex);
+	for (int k = 0; k < std::min(NEIGHBOURS, lists.count); k++)
+	{
+		candidates.push_back(nearest[k]);
+		candidates.push_back(getPrev(nearest[k]));
+	}
+	int before[WINDOW];
+	int walk = vertex;
+	for (int k = 0; k < WINDOW; k++)
+	{
+		walk = getPrev(walk);
+		before[k] = walk;
+	}
+	for (int k = WINDOW - 1; k >= 0; k--)
+	{
+		candidates.push_back(before[k]);
+	}
+	walk = vertex;
+	for (int k = 0; k < WINDOW; k++)
+	{
+		walk = getNext(walk);
+		candidates.push_back(walk);
+	}
+	int prev = getPrev(vertex);
+	int next = getNext(vertex);
+	double removal = weight(prev, vertex) + weight(vertex, next) - weight(prev, next);
+	double best = -EPSILON;
+	int best_after = -1;
+	int best_swap = -1;
+	for (size_t i = 0; i < candidates.size(); i++)
+	{
+		int c = candidates[i];
+		if (c == vertex)
+		{
+			continue;
+		}
+		if (c != prev)
+		{
+			int d = getNext(c);
+			double delta = weight(c, vertex) + weight(vertex, d) - weight(c, d) - removal;
+			if (delta < best)
+			{
+				best = delta;
+				best_after = c;
+				best_swap = -1;
+			}
+		}
+		if (c != 0)
+		{
+			double delta = getSwapDelta(vertex, c);
+			if (delta < best)
+			{
+				best = delta;
+				best_after = -1;
+				best_swap = c;
+			}
+		}
+	}
+	if (best_after < 0 && best_swap < 0)
+	{
+		return false;
+	}
+	touched.push_back(vertex);
+	touched.push_back(prev);
+	touched.push_back(next);
+	int other = best_after >= 0 ? best_after : best_swap;
+	touched.push_back(other);
+	touched.push_back(getPrev(other));
+	touched.push_back(getNext(other));
+	if (best_after >= 0)
+	{
+		relocate(vertex, best_after);
+	}
+	else
+	{
+		swapVertices(vertex, best_swap);
+	}
+	mWeight += best;
+	return true;
+}
+
+//Change in tour weight from exchanging the places of a and b.
+double DynamicTour::getSwapDelta(int a, int b) const {
+	if (mNext[b] == a)
+	{
+		std::swap(a, b);
+	}
+	int pa = mPrev[a], na = mNext[a], pb = mPrev[b], nb = mNext[b];
+	if (na == b)
+	{
+		return weight(pa, b) + weight(b, a) + weight(a, nb)
+			- weight(pa, a) - weight(a, b) - weight(b, nb);
+	}
+	return weight(pa, b) + weight(b, na) + weight(pb, a) + weight(a, nb)
+		- weight(pa, a) - weight(a, na) - weight(pb, b) - weight(b, nb);
+}
+
+void DynamicTour::relocate(int vertex, int after) {
+	mNext[mPrev[vertex]] = mNext[vertex];
+	mPrev[mNext[vertex]] = mPrev[vertex];
+	int next = mNext[after];
+	mNext[after] = vertex;
+	mPrev[vertex] = after;
+	mNext[vertex] = next;
+	mPrev[next] = vertex;
+	mPathStale = true;
+}
+
+void DynamicTour::swapVertices(int a, int b) {
+	if (mNext[b] == a)
+	{
+		std::swap(a, b);
+	}
+	int pa = mPrev[a], na = mNext[a], pb = mPrev[b], nb = mNext[b];
+	if (na == b)
+	{
+		mNext[pa] = b;
+		mPrev[b] = pa;
+		mNext[b] = a;
+		mPrev[a] = b;
+		mNext[a] = nb;
+		mPrev[nb] = a;
+	}
+	else
+	{
+		mNext[pa] = b;
+		mPrev[b] = pa;
+		mNext[b] = na;
+		mPrev[na] = b;
+		mNext[pb] = a;
+		mPrev[a] = pb;
+		mNext[a] = nb;
+		mPrev[nb] = a;
+	}
+	mPathStale = true;
+}
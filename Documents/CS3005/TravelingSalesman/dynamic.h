@@ -0,0 +1,47 @@
+#pragma once
+#include "graph.h"
+#include <vector>
+
+//One changed edge, 0-based like Graph::getWeight.
+struct WeightUpdate
+{
+	int from;
+	int to;
+	double weight;
+};
+
+//A tour kept up to date while the graph's weights change. update() applies
+//the new weights and repairs the tour with node relocations and swaps,
+//starting from the endpoints of the changed edges, trying them next to their
+//nearest neighbours and nearby tour positions, and only spreading to
+//vertices whose tour edges a move touched. The tour is a doubly linked
+//list, so every move is O(1) wherever its endpoints sit and the work
+//follows the size of the change rather than n; getPath() walks the list
+//again, in O(n), only when it changed since the last call.
+class DynamicTour
+{
+public:
+	DynamicTour(Graph& g, const std::vector<int>& path);
+	void update(const std::vector<WeightUpdate>& updates);
+	const std::vector<int>& getPath() const;
+	//Kept incrementally; equal to getPathWeight(getPath()) up to rounding.
+	double getWeight() const;
+private:
+	int getPrev(int vertex) const;
+	int getNext(int vertex) const;
+	double weight(int from, int to) const;
+	double getSwapDelta(int a, int b) const;
+	bool improveVertex(int vertex, const std::vector<int>& partners, const NeighbourLists& lists,
+		std::vector<int>& touched);
+	void relocate(int vertex, int after);
+	void swapVertices(int a, int b);
+	Graph& mGraph;
+	//Successor and predecessor of each 0-based vertex.
+	std::vector<int> mNext;
+	std::vector<int> mPrev;
+	//1-based like every other path, starting from the first vertex of the
+	//path the tour was built from.
+	mutable std::vector<int> mPath;
+	mutable bool mPathStale;
+	double mWeight;
+};
@@ -0,0 +1,211 @@
+#include "graph.h"
+#include "rng.h"
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+//Writes synthetic instances for scale testing. Points are generated in a
+//square whose side grows with sqrt(n), so density stays the same as n
+//grows. Matrix formats write one row at a time and never hold n*n values.
+
+namespace {
+
+const double kSide = 1000.0;
+
+void makePoints(const std::string& dist, int n, unsigned seed, std::vector<double>& x, std::vector<double>& y) {
+	std::mt19937 rng(seed);
+	double side = kSide * std::sqrt(n / 1000.0 + 1.0);
+	std::uniform_real_distribution<double> coord(0.0, side);
+	x.resize(n);
+	y.resize(n);
+	if (dist == "grid")
+	{
+		int columns = std::ceil(std::sqrt(double(n)));
+		double spacing = side / columns;
+		for (int i = 0; i < n; i++)
+		{
+			x[i] = (i % columns) * spacing;
+			y[i] = (i / columns) * spacing;
+		}
+	}
+	else if (dist == "clustered")
+	{
+		int clusters = std::max(1, n / 100);
+		std::vector<double> cx(clusters), cy(clusters);
+		for (int c = 0; c < clusters; c++)
+		{
+			cx[c] = coord(rng);
+			cy[c] = coord(rng);
+		}
+		std::uniform_int_distribution<int> pick(0, clusters - 1);
+		std::normal_distribution<double> spread(0.0, side / (4.0 * std::sqrt(double(clusters))));
+		for (int i = 0; i < n; i++)
+		{
+			int c = pick(rng);
+			x[i] = cx[c] + spread(rng);
+			y[i] = cy[c] + spread(rng);
+		}
+	}
+	else
+	{
+		for (int i = 0; i < n; i++)
+		{
+			x[i] = coord(rng);
+			y[i] = coord(rng);
+		}
+	}
+}
+
+//Per-direction stretch in [1, 1.5) for asymmetric instances, derived from
+//(i, j, seed) so rows can be produced independently.
+double stretch(int i, int j, unsigned seed) {
+	uint64_t h = mix64((uint64_t(uint32_t(i)) << 32 | uint32_t(j)) ^ (uint64_t(seed) * 0x9e3779b97f4a7c15ULL));
+	return 1.0 + 0.5 * (h >> 11) * (1.0 / 9007199254740992.0);
+}
+
+void writeRows(std::ostream& out, const std::string& format, bool asymmetric, unsigned seed,
+	const std::vector<double>& x, const std::vector<double>& y) {
+	int n = x.size();
+	if (format == "binary")
+	{
+		BinaryHeader header = makeBinaryHeader(BINARY_MATRIX, n);
+		out.write((const char*)&header, sizeof(header));
+	}
+	else
+	{
+		out << n << '\n';
+	}
+	std::vector<double> row(n);
+	for (int i = 0; i < n; i++)
+	{
+		for (int j = 0; j < n; j++)
+		{
+			row[j] = i == j ? 0.0 : std::hypot(x[i] - x[j], y[i] - y[j]);
+			if (asymmetric && i != j)
+			{
+				row[j] *= stretch(i, j, seed);
+			}
+		}
+		if (format == "binary")
+		{
+			out.write((const char*)row.data(), n * sizeof(double));
+			continue;
+		}
+		for (int j = 0; j < n; j++)
+		{
+			if (j != i)
+			{
+				out << i + 1 << ' ' << j + 1 << ' ' << row[j] << '\n';
+			}
+		}
+	}
+}
+
+void writeCoordinates(std::ostream& out, const std::string& format, const std::vector<double>& x, const std::vector<double>& y) {
+	int n = x.size();
+	if (format == "coords-binary")
+	{
+		BinaryHeader header = makeBinaryHeader(BINARY_COORDINATES, n);
+		out.write((const char*)&header, sizeof(header));
+		for (int i = 0; i < n; i++)
+		{
+			double point[2] = { x[i], y[i] };
+			out.write((const char*)point, sizeof(point));
+		}
+		return;
+	}
+	out << "coords " << n << '\n';
+	for (int i = 0; i < n; i++)
+	{
+		out << i + 1 << ' ' << x[i] << ' ' << y[i] << '\n';
+	}
+}
+
+int usage() {
+	std::cerr << "usage: TSP-gen --n N [--dist uniform|clustered|grid|asymmetric]" << std::endl;
+	std::cerr << "               [--format text|binary|coords|coords-binary] [--seed S] [--out file]" << std::endl;
+	return 1;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+	int n = 0;
+	unsigned seed = 1;
+	std::string dist = "uniform", format = "text", out_path;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (i + 1 >= argc)
+		{
+			return usage();
+		}
+		std::string value = argv[++i];
+		if (arg == "--n")
+		{
+			n = std::atoi(value.c_str());
+		}
+		else if (arg == "--dist")
+		{
+			dist = value;
+		}
+		else if (arg == "--format")
+		{
+			format = value;
+		}
+		else if (arg == "--seed")
+		{
+			seed = std::strtoul(value.c_str(), NULL, 10);
+		}
+		else if (arg == "--out")
+		{
+			out_path = value;
+		}
+		else
+		{
+			return usage();
+		}
+	}
+	bool coordinates = format == "coords" || format == "coords-binary";
+	if (n < 2 || (dist != "uniform" && dist != "clustered" && dist != "grid" && dist != "asymmetric") ||
+		(!coordinates && format != "text" && format != "binary"))
+	{
+		return usage();
+	}
+	if (coordinates && dist == "asymmetric")
+	{
+		std::cerr << "asymmetric instances need a matrix format" << std::endl;
+		return 1;
+	}
+
+	std::ofstream file;
+	if (!out_path.empty())
+	{
+		file.open(out_path.c_str(), std::ios::binary);
+		if (!file)
+		{
+			std::cerr << "could not write " << out_path << std::endl;
+			return 1;
+		}
+	}
+	std::ostream& out = out_path.empty() ? std::cout : file;
+	out << std::setprecision(10);
+
+	std::vector<double> x, y;
+	makePoints(dist, n, seed, x, y);
+	if (coordinates)
+	{
+		writeCoordinates(out, format, x, y);
+	}
+	else
+	{
+		writeRows(out, format, dist == "asymmetric", seed, x, y);
+	}
+	out.flush();
+	return out ? 0 : 1;
+}
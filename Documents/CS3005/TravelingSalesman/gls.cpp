@@ -0,0 +1,280 @@
+#include "gls.h"
+#include "heuristics.h"
+#include <algorithm>
+#include <deque>
+#include <queue>
+
+namespace {
+
+const double EPSILON = 1e-9;
+
+//Swaps driven by neighbour lists and don't-look bits, on the weights plus
+//lambda per penalty.
+class GuidedTour
+{
+public:
+	GuidedTour(const Graph& g, const EdgePenalties& penalties, const std::vector<int>& path)
+		:
+		mGraph(g), mPenalties(penalties), mPath(path), mPosition(path.size() + 1), mActive(path.size() + 1, 1),
+		mQueue(path.begin() + 1, path.end()), mWeight(g.getPathWeight(path)), mLambda(0.0) {
+		for (size_t i = 0; i < path.size(); i++)
+		{
+			mPosition[path[i]] = i;
+		}
+	}
+	void setLambda(double lambda) { mLambda = lambda; }
+	//1-based vertex, as in paths.
+	void activate(int vertex);
+	//Stops early, leaving the queue, once the control stops.
+	void descend(const NeighbourLists& lists, int neighbours, SolverCounters& counters, const SolveControl& control);
+	const std::vector<int>& getPath() const { return mPath; }
+	double getWeight() const { return mWeight; }
+	int getSuccessor(int vertex) const { return mPath[(mPosition[vertex] + 1) % mPath.size()]; }
+	//Edges the applied swaps put into the tour since the last call, as
+	//1-based from, to pairs.
+	std::vector<int> takeCreated();
+private:
+	double getCost(int a, int b) const;
+	void trySwaps(int vertex, const NeighbourLists& lists, int neighbours, SolverCounters& counters);
+	const Graph& mGraph;
+	const EdgePenalties& mPenalties;
+	std::vector<int> mPath;
+	std::vector<int> mPosition;
+	std::vector<char> mActive;
+	std::deque<int> mQueue;
+	std::vector<int> mCreated;
+	double mWeight;
+	double mLambda;
+};
+
+std::vector<int> GuidedTour::takeCreated() {
+	std::vector<int> created;
+	created.swap(mCreated);
+	return created;
+}
+
+double GuidedTour::getCost(int a, int b) const {
+	return mGraph.getWeight(a - 1, b - 1) + mLambda * mPenalties.get(a - 1, b - 1);
+}
+
+void GuidedTour::activate(int vertex) {
+	if (vertex != mPath[0] && !mActive[vertex])
+	{
+		mActive[vertex] = 1;
+		mQueue.push_back(vertex);
+	}
+}
+
+void GuidedTour::descend(const NeighbourLists& lists, int neighbours, SolverCounters& counters, const SolveControl& control) {
+	while (!mQueue.empty() && !control.shouldStop())
+	{
+		int vertex = mQueue.front();
+		mQueue.pop_front();
+		mActive[vertex] = 0;
+		trySwaps(vertex, lists, neighbours, counters);
+	}
+}
+
+//Tries putting `vertex` just before or just after each of its near
+//neighbours by swapping it with the vertex already there.
+void GuidedTour::trySwaps(int vertex, const NeighbourLists& lists, int neighbours, SolverCounters& counters) {
+	int n = mPath.size();
+	const int* near = lists.getIds(vertex - 1);
+	int count = std::min(neighbours, lists.count);
+	for (int c = 0; c < 2 * count; c++)
+	{
+		int x = mPosition[vertex];
+		int y = (mPosition[near[c / 2] + 1] + (c % 2 ? 1 : n - 1)) % n;
+		if (y == 0 || y == x)
+		{
+			continue;
+		}
+		int edges[4];
+		int touched = getSwapEdges(n, x, y, edges);
+		double before = 0.0, after = 0.0, base = 0.0;
+		for (int e = 0; e < touched; e++)
+		{
+			int a = mPath[edges[e]], b = mPath[(edges[e] + 1) % n];
+			before += getCost(a, b);
+			base -= mGraph.getWeight(a - 1, b - 1);
+		}
+		std::swap(mPath[x], mPath[y]);
+		for (int e = 0; e < touched; e++)
+		{
+			int a = mPath[edges[e]], b = mPath[(edges[e] + 1) % n];
+			after += getCost(a, b);
+			base += mGraph.getWeight(a - 1, b - 1);
+		}
+		counters.evaluations++;
+		if (after - before < -EPSILON)
+		{
+			mPosition[mPath[x]] = x;
+			mPosition[mPath[y]] = y;
+			mWeight += base;
+			for (int e = 0; e < touched; e++)
+			{
+				activate(mPath[edges[e]]);
+				activate(mPath[(edges[e] + 1) % n]);
+				mCreated.push_back(mPath[edges[e]]);
+				mCreated.push_back(mPath[(edges[e] + 1) % n]);
+			}
+			return;
+		}
+		std::swap(mPath[x], mPath[y]);
+	}
+}
+
+//A tour edge and its weight / (1 + penalty), 1-based.
+struct EdgeUtility
+{
+	double utility;
+	int from;
+	int to;
+	bool operator<(const EdgeUtility& other) const { return utility < other.utility; }
+};
+
+//Every tour edge by utility. Entries are never removed in place: an entry
+//whose edge has left the tour, or whose penalty has grown since, is
+//dropped when it reaches the top, and the heap is rebuilt from the tour
+//once stale entries outnumber live ones three to one.
+class UtilityHeap
+{
+public:
+	UtilityHeap(const Graph& g, const EdgePenalties& penalties)
+		:
+		mGraph(g), mPenalties(penalties), mHeap() {
+	}
+	void push(int from, int to);
+	void rebuild(const GuidedTour& tour);
+	EdgeUtility popTop(const GuidedTour& tour);
+private:
+	double getUtility(int from, int to) const;
+	const Graph& mGraph;
+	const EdgePenalties& mPenalties;
+	std::priority_queue<EdgeUtility> mHeap;
+};
+
+double UtilityHeap::getUtility(int from, int to) const {
+	return mGraph.getWeight(from - 1, to - 1) / (1 + mPenalties.get(from - 1, to - 1));
+}
+
+void UtilityHeap::push(int from, int to) {
+	EdgeUtility entry;
+	entry.utility = getUtility(from, to);
+	entry.from = from;
+	entry.to = to;
+	mHeap.push(entry);
+}
+
+void UtilityHeap::rebuild(const GuidedTour& tour) {
+	const std::vector<int>& path = tour.getPath();
+	int n = path.size();
+	mHeap = std::priority_queue<EdgeUtility>();
+	for (int e = 0; e < n; e++)
+	{
+		push(path[e], path[(e + 1) % n]);
+	}
+}
+
+EdgeUtility UtilityHeap::popTop(const GuidedTour& tour) {
+	if (mHeap.size() > 4 * tour.getPath().size())
+	{
+		rebuild(tour);
+	}
+	while (true)
+	{
+		EdgeUtility top = mHeap.top();
+		mHeap.pop();
+		if (tour.getSuccessor(top.from) == top.to && getUtility(top.from, top.to) == top.utility)
+		{
+			return top;
+		}
+	}
+}
+
+}
+
+GuidedParams defaultGuidedParams(const Graph& g) {
+	GuidedParams params;
+	params.alpha = 0.3;
+	params.rounds = 20 * g.getSize();
+	params.neighbours = 10;
+	return params;
+}
+
+EdgePenalties::EdgePenalties(int size)
+	:
+	mOut(size, 0), mIn(size, 0), mCounts() {
+}
+
+int EdgePenalties::get(int i, int j) const {
+	if (!mOut[i] || !mIn[j])
+	{
+		return 0;
+	}
+	std::unordered_map<uint64_t, int>::const_iterator found = mCounts.find(uint64_t(i) << 32 | uint32_t(j));
+	return found == mCounts.end() ? 0 : found->second;
+}
+
+void EdgePenalties::add(int i, int j) {
+	mOut[i] = 1;
+	mIn[j] = 1;
+	mCounts[uint64_t(i) << 32 | uint32_t(j)]++;
+}
+
+std::vector<int> TSPGuidedLocalSearch(Graph& g) {
+	SolveControl control(g, SolveClock::time_point::max());
+	return TSPGuidedLocalSearch(g, defaultGuidedParams(g), control);
+}
+
+std::vector<int> TSPGuidedLocalSearch(Graph& g, const GuidedParams& params, SolveControl& control) {
+	int n = g.getSize();
+	std::vector<int> best = getRandomCycle(g);
+	if (n < 4)
+	{
+		control.offer(best);
+		return best;
+	}
+	std::shared_ptr<const NeighbourLists> lists = g.getNeighbours(params.neighbours,
+		[&control]() { return control.shouldStop(); });
+	if (!lists)
+	{
+		control.offer(best);
+		return best;
+	}
+	EdgePenalties penalties(n);
+	GuidedTour tour(g, penalties, best);
+	double best_weight = tour.getWeight();
+	control.offer(best, best_weight);
+	UtilityHeap utilities(g, penalties);
+	utilities.rebuild(tour);
+	tour.takeCreated();
+	SolverCounters counters;
+	for (int round = 0; round < params.rounds && !control.shouldStop(); round++)
+	{
+		tour.descend(*lists, params.neighbours, counters, control);
+		if (tour.getWeight() < best_weight - EPSILON)
+		{
+			best = tour.getPath();
+			best_weight = tour.getWeight();
+			counters.improvements++;
+			control.offer(best, best_weight);
+		}
+		if (round == 0)
+		{
+			tour.setLambda(params.alpha * tour.getWeight() / n);
+		}
+		std::vector<int> created = tour.takeCreated();
+		for (size_t e = 0; e < created.size(); e += 2)
+		{
+			utilities.push(created[e], created[e + 1]);
+		}
+		EdgeUtility top = utilities.popTop(tour);
+		penalties.add(top.from - 1, top.to - 1);
+		utilities.push(top.from, top.to);
+		tour.activate(top.from);
+		tour.activate(top.to);
+	}
+	control.addCounters(counters);
+	return best;
+}
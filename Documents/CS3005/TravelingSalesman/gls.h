@@ -0,0 +1,42 @@
+#pragma once
+#include "anytime.h"
+#include "graph.h"
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+struct GuidedParams
+{
+	//Penalty weight as a fraction of the average edge of the first optimum.
+	double alpha;
+	//Penalty rounds before giving up.
+	int rounds;
+	//Near neighbours each vertex is tried next to.
+	int neighbours;
+};
+
+GuidedParams defaultGuidedParams(const Graph& g);
+
+//Penalty counts of directed edges, kept beside the Graph rather than in
+//it. Only edges leaving a vertex with a penalised out-edge and entering
+//one with a penalised in-edge are looked up in the hash; every other edge
+//costs two flag reads.
+class EdgePenalties
+{
+public:
+	EdgePenalties(int size);
+	int get(int i, int j) const;
+	void add(int i, int j);
+private:
+	std::vector<char> mOut;
+	std::vector<char> mIn;
+	std::unordered_map<uint64_t, int> mCounts;
+};
+
+//Guided local search over the hill climber's swap neighbourhood. At each
+//local optimum the tour edge with the highest weight / (1 + penalty) is
+//penalised, and the search continues from the same tour on the penalised
+//weights, with only the penalised edge's endpoints re-examined. Utilities
+//live in a heap that only hears about edges a move or penalty changed.
+std::vector<int> TSPGuidedLocalSearch(Graph& g);
+std::vector<int> TSPGuidedLocalSearch(Graph& g, const GuidedParams& params, SolveControl& control);
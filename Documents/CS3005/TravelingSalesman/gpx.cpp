@@ -0,0 +1,313 @@
+#include "gpx.h"
+#include "heuristics.h"
+#include "parallel.h"
+#include "rng.h"
+#include <algorithm>
+#include <unordered_map>
+
+namespace {
+
+int findRoot(std::vector<int>& parent, int x) {
+	while (parent[x] != x)
+	{
+		parent[x] = parent[parent[x]];
+		x = parent[x];
+	}
+	return x;
+}
+
+double pathWeight(const Graph& g, const std::vector<int>& path) {
+	double weight = 0.0;
+	for (size_t i = 0; i < path.size(); i++)
+	{
+		weight += g.getWeight(path[i] - 1, path[(i + 1) % path.size()] - 1);
+	}
+	return weight;
+}
+
+//Successor/predecessor of every vertex (1-based) in a tour.
+void links(const std::vector<int>& path, std::vector<int>& next, std::vector<int>& prev) {
+	size_t n = path.size();
+	next.assign(n + 1, 0);
+	prev.assign(n + 1, 0);
+	for (size_t i = 0; i < n; i++)
+	{
+		next[path[i]] = path[(i + 1) % n];
+		prev[path[(i + 1) % n]] = path[i];
+	}
+}
+
+bool shared(int x, int y, const std::vector<int>& next, const std::vector<int>& prev) {
+	return next[x] == y || prev[x] == y;
+}
+
+double segmentWeight(const Graph& g, const std::vector<int>& seg) {
+	double weight = 0.0;
+	for (size_t i = 0; i + 1 < seg.size(); i++)
+	{
+		weight += g.getWeight(seg[i] - 1, seg[i + 1] - 1);
+	}
+	return weight;
+}
+
+//A position of `tour` where a stretch of one component begins, or -1 if
+//the whole tour lies in one component.
+int findRunStart(const std::vector<int>& tour, const std::vector<int>& comp) {
+	int n = tour.size();
+	for (int i = 0; i < n; i++)
+	{
+		if (comp[tour[i]] != comp[tour[(i + n - 1) % n]])
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+//The maximal stretches of `tour` inside each component, in tour order
+//from findRunStart, indexed by component.
+bool collectRuns(const std::vector<int>& tour, const std::vector<int>& comp,
+	std::vector< std::vector< std::vector<int> > >& runs) {
+	int n = tour.size();
+	runs.assign(n + 1, std::vector< std::vector<int> >());
+	int start = findRunStart(tour, comp);
+	if (start < 0)
+	{
+		return false;
+	}
+	for (int k = 0; k < n; k++)
+	{
+		int v = tour[(start + k) % n];
+		int c = comp[v];
+		if (c < 0)
+		{
+			continue;
+		}
+		if (k == 0 || comp[tour[(start + k - 1) % n]] != c)
+		{
+			runs[c].push_back(std::vector<int>());
+		}
+		runs[c].back().push_back(v);
+	}
+	return true;
+}
+
+//A component is feasible when the donor's stretches through it join the
+//same pairs of portal vertices as the base's. `matched` then holds, for
+//each base stretch in turn, the donor stretch with the same two ends,
+//turned to start where the base one does.
+bool matchRuns(const std::vector< std::vector<int> >& base_runs, const std::vector< std::vector<int> >& donor_runs,
+	std::vector< std::vector<int> >& matched) {
+	matched.clear();
+	if (base_runs.empty() || base_runs.size() != donor_runs.size())
+	{
+		return false;
+	}
+	std::unordered_map<uint64_t, size_t> by_ends;
+	for (size_t r = 0; r < donor_runs.size(); r++)
+	{
+		int a = donor_runs[r].front(), b = donor_runs[r].back();
+		by_ends[uint64_t(std::min(a, b)) << 32 | uint32_t(std::max(a, b))] = r;
+	}
+	for (size_t r = 0; r < base_runs.size(); r++)
+	{
+		int a = base_runs[r].front(), b = base_runs[r].back();
+		std::unordered_map<uint64_t, size_t>::const_iterator found =
+			by_ends.find(uint64_t(std::min(a, b)) << 32 | uint32_t(std::max(a, b)));
+		if (found == by_ends.end())
+		{
+			return false;
+		}
+		matched.push_back(donor_runs[found->second]);
+		if (matched.back().front() != a)
+		{
+			std::reverse(matched.back().begin(), matched.back().end());
+		}
+	}
+	return true;
+}
+
+//Builds the child that keeps `base` everywhere except in feasible
+//components where `donor` is cheaper.
+std::vector<int> recombine(const Graph& g, const std::vector<int>& base, const std::vector<int>& donor) {
+	int n = base.size();
+	std::vector<int> base_next, base_prev, donor_next, donor_prev;
+	links(base, base_next, base_prev);
+	links(donor, donor_next, donor_prev);
+
+	//Components of the union graph once shared edges are removed.
+	std::vector<int> parent(n + 1);
+	for (int v = 0; v <= n; v++)
+	{
+		parent[v] = v;
+	}
+	std::vector<char> touched(n + 1, 0);
+	for (int v = 1; v <= n; v++)
+	{
+		int ends[2] = { base_next[v], donor_next[v] };
+		for (int e = 0; e < 2; e++)
+		{
+			int u = ends[e];
+			bool in_base = shared(v, u, base_next, base_prev);
+			bool in_donor = shared(v, u, donor_next, donor_prev);
+			if (in_base != in_donor)
+			{
+				parent[findRoot(parent, v)] = findRoot(parent, u);
+				touched[v] = touched[u] = 1;
+			}
+		}
+	}
+	std::vector<int> comp(n + 1, -1);
+	for (int v = 1; v <= n; v++)
+	{
+		if (touched[v])
+		{
+			comp[v] = findRoot(parent, v);
+		}
+	}
+
+	std::vector< std::vector< std::vector<int> > > base_runs, donor_runs, matched(n + 1);
+	std::vector<char> feasible(n + 1, 0);
+	for (int pass = 0; pass < 2; pass++)
+	{
+		if (!collectRuns(base, comp, base_runs) || !collectRuns(donor, comp, donor_runs))
+		{
+			return base;
+		}
+		for (int c = 1; c <= n; c++)
+		{
+			feasible[c] = !base_runs[c].empty() && matchRuns(base_runs[c], donor_runs[c], matched[c]);
+		}
+		//As in GPX2, infeasible components joined by a shared edge are
+		//fused, that edge becoming internal, and tried again as one.
+		bool fused = false;
+		for (int v = 1; pass == 0 && v <= n; v++)
+		{
+			int u = base_next[v];
+			if (comp[v] >= 0 && comp[u] >= 0 && comp[v] != comp[u] && !feasible[comp[v]] && !feasible[comp[u]]
+				&& shared(v, u, donor_next, donor_prev) && findRoot(parent, comp[v]) != findRoot(parent, comp[u]))
+			{
+				parent[findRoot(parent, comp[v])] = findRoot(parent, comp[u]);
+				fused = true;
+			}
+		}
+		if (!fused)
+		{
+			break;
+		}
+		for (int v = 1; v <= n; v++)
+		{
+			if (comp[v] >= 0)
+			{
+				comp[v] = findRoot(parent, comp[v]);
+			}
+		}
+	}
+
+	std::vector<char> use_donor(n + 1, 0);
+	for (int c = 1; c <= n; c++)
+	{
+		if (!feasible[c])
+		{
+			continue;
+		}
+		double from_base = 0.0, from_donor = 0.0;
+		for (size_t r = 0; r < base_runs[c].size(); r++)
+		{
+			from_base += segmentWeight(g, base_runs[c][r]);
+			from_donor += segmentWeight(g, matched[c][r]);
+		}
+		use_donor[c] = from_donor < from_base;
+	}
+
+	std::vector<int> child;
+	child.reserve(n);
+	std::vector<size_t> next_run(n + 1, 0);
+	int start = findRunStart(base, comp);
+	for (int k = 0; k < n; k++)
+	{
+		int v = base[(start + k) % n];
+		int c = comp[v];
+		if (c < 0 || !use_donor[c])
+		{
+			child.push_back(v);
+			continue;
+		}
+		if (k == 0 || comp[base[(start + k - 1) % n]] != c)
+		{
+			const std::vector<int>& run = matched[c][next_run[c]++];
+			child.insert(child.end(), run.begin(), run.end());
+		}
+	}
+	if ((int)child.size() != n)
+	{
+		return base;
+	}
+	std::rotate(child.begin(), std::find(child.begin(), child.end(), 1), child.end());
+	return child;
+}
+
+}
+
+std::vector<int> partitionCrossover(const Graph& g, const std::vector<int>& a, const std::vector<int>& b) {
+	if (a.size() < 4 || a.size() != b.size())
+	{
+		return a;
+	}
+	std::vector<int> from_a = recombine(g, a, b);
+	std::vector<int> from_b = recombine(g, b, a);
+	return pathWeight(g, from_a) <= pathWeight(g, from_b) ? from_a : from_b;
+}
+
+std::vector<int> mergeTours(Graph& g, const std::vector< std::vector<int> >& tours) {
+	SolveControl control(g, SolveClock::time_point::max());
+	return mergeTours(g, tours, control);
+}
+
+std::vector<int> mergeTours(Graph& g, const std::vector< std::vector<int> >& tours, const SolveControl& control) {
+	std::vector<double> weights(tours.size());
+	std::vector<size_t> order;
+	for (size_t i = 0; i < tours.size(); i++)
+	{
+		if (!tours[i].empty())
+		{
+			weights[i] = pathWeight(g, tours[i]);
+			order.push_back(i);
+		}
+	}
+	if (order.empty())
+	{
+		return std::vector<int>();
+	}
+	std::stable_sort(order.begin(), order.end(), [&weights](size_t x, size_t y) { return weights[x] < weights[y]; });
+	std::vector<int> child = tours[order[0]];
+	for (size_t i = 1; i < order.size() && !control.shouldStop(); i++)
+	{
+		child = partitionCrossover(g, child, tours[order[i]]);
+	}
+	return child;
+}
+
+std::vector<int> restartAndMerge(Graph& g, int restarts) {
+	SolveControl control(g, SolveClock::time_point::max());
+	return restartAndMerge(g, restarts, control);
+}
+
+std::vector<int> restartAndMerge(Graph& g, int restarts, SolveControl& control) {
+	std::vector< std::vector<int> > optima(restarts);
+	uint64_t seed = taskRng().next();
+	parallelFor(restarts, [&](size_t i) {
+		if (i > 0 && control.shouldStop())
+		{
+			return;
+		}
+		RngScope scope(seed, i);
+		//Same deadline and token, but only the merge reaches the incumbent.
+		SolveControl restart(g, control.getDeadline(), control.getToken());
+		optima[i] = TSPHillClimb(g, restart);
+		control.absorb(restart);
+	});
+	std::vector<int> merged = mergeTours(g, optima, control);
+	control.offer(merged);
+	return merged;
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include "anytime.h"
+#include "graph.h"
+#include <vector>
+
+//Generalised partition crossover. Removing the edges both parents share
+//splits the union graph into components. A component is feasible when
+//both parents' stretches through it join the same pairs of portal
+//vertices, however many there are, and is inherited from whichever parent
+//is cheaper inside it. As in GPX2, infeasible components joined by a
+//shared edge are fused and tried again. The child is never worse than the
+//better parent.
+std::vector<int> partitionCrossover(const Graph& g, const std::vector<int>& a, const std::vector<int>& b);
+//Folds partitionCrossover over a set of tours, best first, skipping empty
+//ones. With a control, stops folding once it stops.
+std::vector<int> mergeTours(Graph& g, const std::vector< std::vector<int> >& tours);
+std::vector<int> mergeTours(Graph& g, const std::vector< std::vector<int> >& tours, const SolveControl& control);
+//Runs TSPHillClimb restarts in parallel and merges all of the local optima
+//instead of keeping only the best one. Restarts not begun when the control
+//stops are skipped, though one always runs; the merge is offered to the
+//control.
+std::vector<int> restartAndMerge(Graph& g, int restarts);
+std::vector<int> restartAndMerge(Graph& g, int restarts, SolveControl& control);
@@ -1,20 +1,327 @@
 #include "graph.h"
+#include "parallel.h"
+#include "rng.h"
+#include "sha256.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace {
+
+std::mutex gNeighbourBuild;
+
+//Same expression as Graph::getDistance, so the bounds match getWeight.
+double pointDistance(const std::vector<double>& x, const std::vector<double>& y, int i, int j) {
+	return std::hypot(x[i] - x[j], y[i] - y[j]);
+}
+
+double cross(const std::vector<double>& x, const std::vector<double>& y, int o, int a, int b) {
+	return (x[a] - x[o]) * (y[b] - y[o]) - (y[a] - y[o]) * (x[b] - x[o]);
+}
+
+//The farthest pair of points lies on the convex hull (monotone chain),
+//whose antipodal pairs rotating calipers visit in one turn.
+double farthestPair(const std::vector<double>& x, const std::vector<double>& y) {
+	int n = x.size();
+	std::vector<int> sorted(n);
+	for (int i = 0; i < n; i++)
+	{
+		sorted[i] = i;
+	}
+	std::sort(sorted.begin(), sorted.end(), [&x, &y](int a, int b) { return x[a] < x[b] || (x[a] == x[b] && y[a] < y[b]); });
+	std::vector<int> hull(2 * n);
+	int h = 0;
+	for (int i = 0; i < n; i++)
+	{
+		while (h >= 2 && cross(x, y, hull[h - 2], hull[h - 1], sorted[i]) <= 0.0)
+		{
+			h--;
+		}
+		hull[h++] = sorted[i];
+	}
+	for (int i = n - 2, lower = h + 1; i >= 0; i--)
+	{
+		while (h >= lower && cross(x, y, hull[h - 2], hull[h - 1], sorted[i]) <= 0.0)
+		{
+			h--;
+		}
+		hull[h++] = sorted[i];
+	}
+	h = std::max(1, h - 1);
+	double best = 0.0;
+	if (h <= 64)
+	{
+		for (int i = 0; i < h; i++)
+		{
+			for (int j = i + 1; j < h; j++)
+			{
+				best = std::max(best, pointDistance(x, y, hull[i], hull[j]));
+			}
+		}
+		return best;
+	}
+	for (int i = 0, j = 1; i < h; i++)
+	{
+		int next = (i + 1) % h;
+		while (cross(x, y, hull[i], hull[next], hull[(j + 1) % h]) > cross(x, y, hull[i], hull[next], hull[j]))
+		{
+			j = (j + 1) % h;
+		}
+		best = std::max(best, pointDistance(x, y, hull[i], hull[j]));
+		best = std::max(best, pointDistance(x, y, hull[next], hull[j]));
+	}
+	return best;
+}
+
+//Smallest non-zero distance, by a sweep in x over the distinct points
+//with the ones within the best distance so far kept ordered by y.
+//Infinite when every point coincides.
+double closestPair(const std::vector<double>& x, const std::vector<double>& y) {
+	int n = x.size();
+	std::vector<int> sorted(n);
+	for (int i = 0; i < n; i++)
+	{
+		sorted[i] = i;
+	}
+	std::sort(sorted.begin(), sorted.end(), [&x, &y](int a, int b) { return x[a] < x[b] || (x[a] == x[b] && y[a] < y[b]); });
+	sorted.erase(std::unique(sorted.begin(), sorted.end(), [&x, &y](int a, int b) { return x[a] == x[b] && y[a] == y[b]; }), sorted.end());
+	double best = std::numeric_limits<double>::infinity();
+	std::set< std::pair<double, int> > strip;
+	size_t left = 0;
+	for (size_t k = 0; k < sorted.size(); k++)
+	{
+		int i = sorted[k];
+		while (x[i] - x[sorted[left]] > best)
+		{
+			strip.erase(std::make_pair(y[sorted[left]], sorted[left]));
+			left++;
+		}
+		std::set< std::pair<double, int> >::iterator it = strip.lower_bound(std::make_pair(y[i] - best, -1));
+		for (; it != strip.end() && it->first <= y[i] + best; ++it)
+		{
+			double d = pointDistance(x, y, i, it->second);
+			if (d > 0.0 && d < best)
+			{
+				best = d;
+			}
+		}
+		strip.insert(std::make_pair(y[i], i));
+	}
+	return best;
+}
+
+//Buckets the points into square cells, about two points each, so the
+//nearest neighbours of a point are found by searching outward ring by ring
+//instead of over every other point.
+class PointGrid
+{
+public:
+	PointGrid(const std::vector<double>& x, const std::vector<double>& y);
+	//Same lists as fillNeighbourRow on the row of distances from i.
+	void fillRow(NeighbourLists& lists, int i) const;
+private:
+	int getCell(double value, double low, int cells) const;
+	const std::vector<double>& mX;
+	const std::vector<double>& mY;
+	double mLowX;
+	double mLowY;
+	double mCell;
+	int mWidth;
+	int mHeight;
+	//Points of cell c are mMembers[mStart[c]..mStart[c + 1]).
+	std::vector<int> mStart;
+	std::vector<int> mMembers;
+};
+
+PointGrid::PointGrid(const std::vector<double>& x, const std::vector<double>& y) :
+	mX(x), mY(y) {
+	int n = x.size();
+	mLowX = *std::min_element(x.begin(), x.end());
+	mLowY = *std::min_element(y.begin(), y.end());
+	double width = *std::max_element(x.begin(), x.end()) - mLowX;
+	double height = *std::max_element(y.begin(), y.end()) - mLowY;
+	mCell = width * height > 0.0 ? std::sqrt(width * height * 2.0 / n) : std::max(width, height) * 2.0 / n;
+	if (!(mCell > 0.0))
+	{
+		mCell = 1.0;
+	}
+	mWidth = int(width / mCell) + 1;
+	mHeight = int(height / mCell) + 1;
+	mStart.assign(size_t(mWidth) * mHeight + 1, 0);
+	std::vector<int> cells(n);
+	for (int i = 0; i < n; i++)
+	{
+		cells[i] = getCell(y[i], mLowY, mHeight) * mWidth + getCell(x[i], mLowX, mWidth);
+		mStart[cells[i] + 1]++;
+	}
+	for (size_t c = 1; c < mStart.size(); c++)
+	{
+		mStart[c] += mStart[c - 1];
+	}
+	mMembers.resize(n);
+	std::vector<int> next(mStart.begin(), mStart.end() - 1);
+	for (int i = 0; i < n; i++)
+	{
+		mMembers[next[cells[i]]++] = i;
+	}
+}
+
+int PointGrid::getCell(double value, double low, int cells) const {
+	return std::min(cells - 1, int((value - low) / mCell));
+}
+
+//Every point beyond ring r is at least (r - 1) cells away even allowing
+//for rounding at the cell edges, so the search stops once the k-th best
+//distance is nearer than that.
+void PointGrid::fillRow(NeighbourLists& lists, int i) const {
+	int cx = getCell(mX[i], mLowX, mWidth);
+	int cy = getCell(mY[i], mLowY, mHeight);
+	int k = lists.count;
+	std::vector< std::pair<double, int> > found;
+	for (int r = 0; r <= std::max(mWidth, mHeight); r++)
+	{
+		for (int dy = -r; dy <= r; dy++)
+		{
+			int gy = cy + dy;
+			if (gy < 0 || gy >= mHeight)
+			{
+				continue;
+			}
+			int step = (dy == -r || dy == r) ? 1 : 2 * r;
+			for (int dx = -r; dx <= r; dx += std::max(1, step))
+			{
+				int gx = cx + dx;
+				if (gx < 0 || gx >= mWidth)
+				{
+					continue;
+				}
+				int cell = gy * mWidth + gx;
+				for (int m = mStart[cell]; m < mStart[cell + 1]; m++)
+				{
+					int j = mMembers[m];
+					if (j != i)
+					{
+						found.push_back(std::make_pair(pointDistance(mX, mY, i, j), j));
+					}
+				}
+			}
+		}
+		if (int(found.size()) >= k && k > 0)
+		{
+			std::nth_element(found.begin(), found.begin() + k - 1, found.end());
+			if (found[k - 1].first < (r - 1) * mCell)
+			{
+				break;
+			}
+		}
+	}
+	std::partial_sort(found.begin(), found.begin() + k, found.end());
+	int* ids = &lists.ids[size_t(i) * k];
+	double* weights = &lists.weights[size_t(i) * k];
+	for (int c = 0; c < k; c++)
+	{
+		ids[c] = found[c].second;
+		weights[c] = found[c].first;
+	}
+}
+
+}
+
+//WAYS recent distances per vertex, keyed by the higher-numbered endpoint
+//and stored under the lower one. Each slot is a seqlock: a writer that
+//cannot take the slot at once just skips caching, and a reader that sees
+//the sequence move treats the lookup as a miss.
+class DistanceCache
+{
+public:
+	explicit DistanceCache(int size)
+		:
+		mSlots(size_t(size) * WAYS) {
+		for (size_t i = 0; i < mSlots.size(); i++)
+		{
+			mSlots[i].sequence.store(0, std::memory_order_relaxed);
+			mSlots[i].vertex.store(-1, std::memory_order_relaxed);
+			mSlots[i].weight.store(0.0, std::memory_order_relaxed);
+		}
+	}
+	bool find(int i, int j, double& weight) const {
+		const Slot& slot = mSlots[getIndex(i, j)];
+		uint32_t before = slot.sequence.load(std::memory_order_acquire);
+		if (before & 1)
+		{
+			return false;
+		}
+		int vertex = slot.vertex.load(std::memory_order_relaxed);
+		weight = slot.weight.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return vertex == j && slot.sequence.load(std::memory_order_relaxed) == before;
+	}
+	void insert(int i, int j, double weight) {
+		Slot& slot = mSlots[getIndex(i, j)];
+		uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+		if ((sequence & 1) || !slot.sequence.compare_exchange_strong(sequence, sequence + 1, std::memory_order_acquire))
+		{
+			return;
+		}
+		std::atomic_thread_fence(std::memory_order_release);
+		slot.vertex.store(j, std::memory_order_relaxed);
+		slot.weight.store(weight, std::memory_order_relaxed);
+		slot.sequence.store(sequence + 2, std::memory_order_release);
+	}
+private:
+	static const int WAYS = 8;
+	struct Slot
+	{
+		std::atomic<uint32_t> sequence;
+		std::atomic<int> vertex;
+		std::atomic<double> weight;
+	};
+	size_t getIndex(int i, int j) const {
+		return size_t(i) * WAYS + ((uint32_t(j) * 2654435761u) >> 29);
+	}
+	std::vector<Slot> mSlots;
+};
+
 Graph::Graph()
 	:
-	mSize(0), mGraph(),mMinWeight(), mMaxWeight(),mEdges(){
+	mSize(0), mMatrix(),mMinWeight(), mMaxWeight(),mEdges(), mCodes(), mRowBase(), mRowStep(), mRowError(), mExactRows(),
+	mX(), mY(), mCache(), mShared(NULL), mStorage(STORAGE_MATRIX),
+	mHasBounds(false), mBoundsStale(false){
 
 }
 std::vector< std::vector<double> > Graph::getGraph(){
-	return this->mGraph;
+	std::vector< std::vector<double> > graph(mSize);
+	for (int i = 0; i < mSize; i++)
+	{
+		graph[i].assign(getRow(i), getRow(i) + mSize);
+	}
+	return graph;
 }
 
 void Graph::setMaxWeight() {
-	double max = (mGraph)[0][1];
-	for (size_t i = 0; i < mGraph.size(); i++)
+	if (mStorage == STORAGE_COORDINATES)
+	{
+		setCoordinateBounds();
+		return;
+	}
+	double max = getWeight(0, 1);
+	for (int i = 0; i < mSize; i++)
 	{
-		for (size_t j = 0; j < mGraph.size(); j++)
+		const double* row = getRow(i);
+		for (int j = 0; j < mSize; j++)
 		{
-			double x = (mGraph)[i][j];
+			double x = row[j];
 			if (x > max)
 			{
 				max = x;
@@ -23,14 +330,22 @@ void Graph::setMaxWeight() {
 		
 	}
 	mMaxWeight = max * mSize;
+	mHasBounds = true;
+	mBoundsStale = false;
 }
 void Graph::setMinWeight() {
-	double min = (mGraph)[0][1];
-	for (size_t i = 0; i < mGraph.size(); i++)
+	if (mStorage == STORAGE_COORDINATES)
 	{
-		for (size_t j = 0; j < mGraph.size()-1; j++)
+		setCoordinateBounds();
+		return;
+	}
+	double min = getWeight(0, 1);
+	for (int i = 0; i < mSize; i++)
+	{
+		const double* row = getRow(i);
+		for (int j = 0; j < mSize-1; j++)
 		{
-			double x = (mGraph)[i][j];
+			double x = row[j];
 			if (x < min && x>0.0)
 			{
 				min = x;
@@ -38,19 +353,223 @@ void Graph::setMinWeight() {
 		}
 	}
 	mMinWeight = min * mSize;
+	mHasBounds = true;
+	mBoundsStale = false;
 }
 double Graph::getMaxWeight() const {
+	refreshBounds();
 	return mMaxWeight;
 }
 double Graph::getMinWeight() const {
+	refreshBounds();
 	return mMinWeight;
 }
+void Graph::setWeight(int i, int j, double weight) {
+	if (mStorage == STORAGE_COORDINATES || mStorage == STORAGE_SHARED)
+	{
+		return;
+	}
+	double old = getWeight(i, j);
+	if (mStorage == STORAGE_QUANTISED)
+	{
+		//Re-encodes the row, whose range may have changed.
+		std::vector<double> exact(getExactRow(i), getExactRow(i) + mSize);
+		exact[j] = weight;
+		mExactRows->write(size_t(i) * mSize + j, &weight, 1);
+		encodeRow(i, exact.data());
+		weight = getWeight(i, j);
+	}
+	else
+	{
+		mMatrix[size_t(i) * mSize + j] = weight;
+	}
+	if (!mEdges.empty())
+	{
+		mEdges[i * mSize + j] = weight;
+	}
+	updateNeighbours(i, j, weight);
+	if (!mHasBounds || mBoundsStale)
+	{
+		return;
+	}
+	//Growing a bound is O(1); only losing the extreme edge needs a rescan.
+	double max = mMaxWeight / mSize;
+	double min = mMinWeight / mSize;
+	if (weight > max)
+	{
+		mMaxWeight = weight * mSize;
+	}
+	else if (old == max && weight < old)
+	{
+		mBoundsStale = true;
+	}
+	if (j == mSize - 1)
+	{
+		return;
+	}
+	if (weight > 0.0 && weight < min)
+	{
+		mMinWeight = weight * mSize;
+	}
+	else if (old == min && weight != old)
+	{
+		mBoundsStale = true;
+	}
+}
+std::shared_ptr<const NeighbourLists> Graph::getNeighbours(int k) const {
+	return getNeighbours(k, std::function<bool()>());
+}
+std::shared_ptr<const NeighbourLists> Graph::getNeighbours(int k, const std::function<bool()>& stop) const {
+	k = std::max(0, std::min(k, mSize - 1));
+	std::shared_ptr<NeighbourLists> lists = std::atomic_load(&mNeighbours);
+	if (lists && lists->count >= k)
+	{
+		return lists;
+	}
+	//Built without the lock, which parallelFor must not be called under;
+	//two threads racing here both build, and the first to publish wins.
+	std::shared_ptr<NeighbourLists> built = std::make_shared<NeighbourLists>();
+	built->count = k;
+	built->ids.resize(size_t(mSize) * k);
+	built->weights.resize(size_t(mSize) * k);
+	NeighbourLists& rows = *built;
+	std::atomic<bool> stopped(false);
+	std::function<bool()> skip = [&stop, &stopped]() {
+		if (stopped.load(std::memory_order_relaxed))
+		{
+			return true;
+		}
+		if (stop && stop())
+		{
+			stopped.store(true, std::memory_order_relaxed);
+			return true;
+		}
+		return false;
+	};
+	if (mStorage == STORAGE_COORDINATES)
+	{
+		PointGrid grid(mX, mY);
+		parallelFor(mSize, [&grid, &rows, &skip](size_t i) {
+			if (!skip())
+			{
+				grid.fillRow(rows, i);
+			}
+		});
+	}
+	else
+	{
+		parallelFor(mSize, [this, &rows, &skip](size_t i) {
+			if (!skip())
+			{
+				buildNeighbourRow(rows, i);
+			}
+		});
+	}
+	if (stopped.load())
+	{
+		return std::shared_ptr<const NeighbourLists>();
+	}
+	std::lock_guard<std::mutex> lock(gNeighbourBuild);
+	lists = std::atomic_load(&mNeighbours);
+	if (lists && lists->count >= k)
+	{
+		return lists;
+	}
+	std::atomic_store(&mNeighbours, built);
+	return built;
+}
+
+void Graph::setNeighbours(std::shared_ptr<NeighbourLists> lists) {
+	std::atomic_store(&mNeighbours, lists);
+}
+
+void Graph::buildNeighbourRow(NeighbourLists& lists, int i) const {
+	fillNeighbourRow(getRow(i), mSize, i, lists);
+}
+
+void fillNeighbourRow(const double* row, int size, int i, NeighbourLists& lists) {
+	std::vector<int> order;
+	order.reserve(size - 1);
+	for (int j = 0; j < size; j++)
+	{
+		if (j != i)
+		{
+			order.push_back(j);
+		}
+	}
+	std::vector<int>::iterator end = order.begin() + lists.count;
+	std::partial_sort(order.begin(), end, order.end(),
+		[row](int a, int b) { return row[a] < row[b] || (row[a] == row[b] && a < b); });
+	int* ids = &lists.ids[size_t(i) * lists.count];
+	double* weights = &lists.weights[size_t(i) * lists.count];
+	for (int c = 0; c < lists.count; c++)
+	{
+		ids[c] = order[c];
+		weights[c] = row[order[c]];
+	}
+}
+
+//Keeps row i of the lists right after edge (i, j) changed. Only a listed
+//neighbour moving past the end of the list needs the row rebuilt.
+void Graph::updateNeighbours(int i, int j, double weight) {
+	if (!mNeighbours || i == j || mNeighbours->count == 0)
+	{
+		return;
+	}
+	if (!mNeighbours.unique())
+	{
+		//Someone is still reading the old lists; give them a copy to keep.
+		mNeighbours = std::make_shared<NeighbourLists>(*mNeighbours);
+	}
+	NeighbourLists& lists = *mNeighbours;
+	int count = lists.count;
+	int* ids = &lists.ids[size_t(i) * count];
+	double* weights = &lists.weights[size_t(i) * count];
+	int listed = std::find(ids, ids + count, j) - ids;
+	if (listed < count && weight > weights[count - 1])
+	{
+		buildNeighbourRow(lists, i);
+		return;
+	}
+	if (listed == count)
+	{
+		if (weight >= weights[count - 1])
+		{
+			return;
+		}
+		listed = count - 1;
+	}
+	//Drop j (or the last entry), then slide j into its sorted place.
+	for (int c = listed; c + 1 < count; c++)
+	{
+		ids[c] = ids[c + 1];
+		weights[c] = weights[c + 1];
+	}
+	int c = count - 1;
+	while (c > 0 && weights[c - 1] > weight)
+	{
+		ids[c] = ids[c - 1];
+		weights[c] = weights[c - 1];
+		c--;
+	}
+	ids[c] = j;
+	weights[c] = weight;
+}
+
+void Graph::refreshBounds() const {
+	if (mBoundsStale)
+	{
+		Graph& self = const_cast<Graph&>(*this);
+		self.setMaxWeight();
+		self.setMinWeight();
+	}
+}
 void Graph::setEdges() {
 	for (size_t i = 0; i < mSize; i++)
 	{
 		for (size_t j = 0; j < mSize; j++)
 		{
-			mEdges.push_back(mGraph[i][j]);
+			mEdges.push_back(getWeight(i, j));
 		}
 	}
 }
@@ -61,37 +580,301 @@ std::vector<double> Graph::getEdges() const {
 
 void Graph::setSize(const int& size) {
 	mSize = size;
-	mGraph.resize(size);
+	mMatrix.resize(size_t(size) * size);
+	mCodes.clear();
+	mRowBase.clear();
+	mRowStep.clear();
+	mRowError.clear();
+	mExactRows.reset();
+	mX.clear();
+	mY.clear();
+	mCache.reset();
+	mShared = NULL;
+	mStorage = STORAGE_MATRIX;
+	std::atomic_store(&mNeighbours, std::shared_ptr<NeighbourLists>());
 }
 int Graph::getSize() const {
 	return this->mSize;
 }
+const double* Graph::getRow(int i) const {
+	if (mStorage == STORAGE_MATRIX)
+	{
+		return mMatrix.data() + size_t(i) * mSize;
+	}
+	if (mStorage == STORAGE_SHARED)
+	{
+		return mShared + size_t(i) * mSize;
+	}
+	static thread_local std::vector<double> decoded;
+	decoded.resize(mSize);
+	if (mStorage == STORAGE_QUANTISED)
+	{
+		const uint16_t* codes = &mCodes[size_t(i) * mSize];
+		for (int j = 0; j < mSize; j++)
+		{
+			decoded[j] = mRowBase[i] + codes[j] * mRowStep[i];
+		}
+	}
+	else
+	{
+		for (int j = 0; j < mSize; j++)
+		{
+			decoded[j] = getDistance(i, j);
+		}
+	}
+	return decoded.data();
+}
+double Graph::getWeight(int i, int j) const {
+	if (mStorage == STORAGE_MATRIX)
+	{
+		return mMatrix[size_t(i) * mSize + j];
+	}
+	if (mStorage == STORAGE_SHARED)
+	{
+		return mShared[size_t(i) * mSize + j];
+	}
+	if (mStorage == STORAGE_QUANTISED)
+	{
+		return mRowBase[i] + mCodes[size_t(i) * mSize + j] * mRowStep[i];
+	}
+	int low = std::min(i, j);
+	int high = std::max(i, j);
+	double weight;
+	if (!mCache->find(low, high, weight))
+	{
+		weight = getDistance(low, high);
+		mCache->insert(low, high, weight);
+	}
+	return weight;
+}
+double Graph::getDistance(int i, int j) const {
+	return std::hypot(mX[i] - mX[j], mY[i] - mY[j]);
+}
+void Graph::useCoordinates(const std::vector<double>& x, const std::vector<double>& y) {
+	setSize(0);
+	mSize = x.size();
+	mX = x;
+	mY = y;
+	mCache = std::make_shared<DistanceCache>(mSize);
+	mStorage = STORAGE_COORDINATES;
+	setCoordinateBounds();
+}
+//Distances are symmetric, so setMinWeight's skipped last column is still
+//seen through the last row and both scans reduce to the farthest pair and
+//the closest pair at non-zero distance, each seeded with edge (0, 1).
+void Graph::setCoordinateBounds() {
+	double first = getDistance(0, 1);
+	double min = first;
+	double closest = closestPair(mX, mY);
+	if (closest < min)
+	{
+		min = closest;
+	}
+	setBounds(std::max(first, farthestPair(mX, mY)), min);
+}
+void Graph::useSharedMatrix(const double* rows, int size) {
+	setSize(0);
+	mSize = size;
+	mShared = rows;
+	mStorage = STORAGE_SHARED;
+}
+bool Graph::hasCoordinates() const {
+	return mStorage == STORAGE_COORDINATES;
+}
+bool Graph::useQuantised(int size, std::string& error) {
+	setSize(0);
+	std::shared_ptr<FileMatrix> exact = std::make_shared<FileMatrix>();
+	if (!exact->open(size_t(size) * size, error))
+	{
+		return false;
+	}
+	mSize = size;
+	mCodes.resize(size_t(size) * size);
+	mRowBase.assign(size, 0.0);
+	mRowStep.assign(size, 0.0);
+	mRowError.assign(size, 0.0);
+	mExactRows = exact;
+	mStorage = STORAGE_QUANTISED;
+	mHasBounds = false;
+	mBoundsStale = false;
+	return true;
+}
+//The row's range, diagonal included, split into 65535 steps; a row of
+//equal weights decodes exactly with step 0.
+void Graph::encodeRow(int i, const double* edges) {
+	double min = *std::min_element(edges, edges + mSize);
+	double max = *std::max_element(edges, edges + mSize);
+	double step = (max - min) / 65535.0;
+	uint16_t* codes = &mCodes[size_t(i) * mSize];
+	double error = 0.0;
+	for (int j = 0; j < mSize; j++)
+	{
+		double code = step > 0.0 ? (edges[j] - min) / step + 0.5 : 0.0;
+		codes[j] = uint16_t(std::max(0.0, std::min(65535.0, code)));
+		error = std::max(error, std::fabs(min + codes[j] * step - edges[j]));
+	}
+	mRowBase[i] = min;
+	mRowStep[i] = step;
+	mRowError[i] = error;
+}
+bool Graph::quantiseFrom(const Graph& source, std::string& error) {
+	int n = source.getSize();
+	if (!useQuantised(n, error))
+	{
+		return false;
+	}
+	parallelFor(n, [this, &source](size_t i) {
+		setRow(i, source.getExactRow(i));
+	});
+	copyBounds(source);
+	return true;
+}
+bool Graph::isQuantised() const {
+	return mStorage == STORAGE_QUANTISED;
+}
+double Graph::getQuantisationError() const {
+	return mRowError.empty() ? 0.0 : *std::max_element(mRowError.begin(), mRowError.end());
+}
+const double* Graph::getExactRow(int i) const {
+	if (mStorage != STORAGE_QUANTISED)
+	{
+		return getRow(i);
+	}
+	static thread_local std::vector<double> exact;
+	exact.resize(mSize);
+	mExactRows->read(size_t(i) * mSize, exact.data(), mSize);
+	return exact.data();
+}
+double Graph::getExactPathWeight(const std::vector<int>& path) const {
+	if (mStorage != STORAGE_QUANTISED)
+	{
+		return getPathWeight(path);
+	}
+	double weight = 0.0;
+	for (size_t i = 0; i < path.size(); i++)
+	{
+		int from = path[i] - 1;
+		int to = i + 1 < path.size() ? path[i + 1] - 1 : 0;
+		double edge;
+		mExactRows->read(size_t(from) * mSize + to, &edge, 1);
+		weight += edge;
+	}
+	return weight;
+}
+uint64_t Graph::getFingerprint() const {
+	uint64_t hash = mix64(mSize);
+	if (mStorage == STORAGE_COORDINATES)
+	{
+		for (int i = 0; i < mSize; i++)
+		{
+			uint64_t bits[2];
+			std::memcpy(&bits[0], &mX[i], sizeof(bits[0]));
+			std::memcpy(&bits[1], &mY[i], sizeof(bits[1]));
+			hash = mix64(mix64(hash ^ bits[0]) ^ bits[1]) + i;
+		}
+		return hash;
+	}
+	for (int i = 0; i < mSize; i++)
+	{
+		const double* row = getExactRow(i);
+		for (int j = 0; j < mSize; j++)
+		{
+			uint64_t bits;
+			std::memcpy(&bits, &row[j], sizeof(bits));
+			hash = mix64(hash ^ bits) + j;
+		}
+	}
+	return hash;
+}
+std::string Graph::getDigest() const {
+	Sha256 hash;
+	int64_t size = mSize;
+	hash.update(&size, sizeof(size));
+	if (mStorage == STORAGE_COORDINATES)
+	{
+		hash.update(mX.data(), mX.size() * sizeof(double));
+		hash.update(mY.data(), mY.size() * sizeof(double));
+		return hash.hexDigest();
+	}
+	for (int i = 0; i < mSize; i++)
+	{
+		hash.update(getExactRow(i), size_t(mSize) * sizeof(double));
+	}
+	return hash.hexDigest();
+}
 void Graph::pushBack(std::vector<double> edges,int a) {
-	mGraph[a-1]=edges;
+	setRow(a - 1, edges.data());
+}
+void Graph::setRow(int i, const double* edges) {
+	if (mStorage == STORAGE_QUANTISED)
+	{
+		mExactRows->write(size_t(i) * mSize, edges, mSize);
+		encodeRow(i, edges);
+		std::atomic_store(&mNeighbours, std::shared_ptr<NeighbourLists>());
+		return;
+	}
+	std::copy(edges, edges + mSize, mMatrix.data() + size_t(i) * mSize);
+	std::atomic_store(&mNeighbours, std::shared_ptr<NeighbourLists>());
+}
+void Graph::setBounds(double max_edge, double min_edge) {
+	mMaxWeight = max_edge * mSize;
+	mMinWeight = min_edge * mSize;
+	mHasBounds = true;
+	mBoundsStale = false;
+}
+void Graph::copyBounds(const Graph& source) {
+	source.refreshBounds();
+	mMaxWeight = source.mMaxWeight;
+	mMinWeight = source.mMinWeight;
+	mHasBounds = source.mHasBounds;
+	mBoundsStale = false;
+}
+bool Graph::hasBounds() const {
+	return mHasBounds;
 }
 
-double Graph::getPathWeight(std::vector<int>& path) {
+double Graph::getPathWeight(const std::vector<int>& path) const {
+	if (mStorage == STORAGE_QUANTISED)
+	{
+		//Straight off the codes, without getWeight's storage dispatch.
+		const uint16_t* codes = mCodes.data();
+		const double* base = mRowBase.data();
+		const double* step = mRowStep.data();
+		size_t n = mSize;
+		double weight = 0.0;
+		for (size_t i = 0; i < n; i++)
+		{
+			size_t from = path[i] - 1;
+			size_t to = i + 1 < n ? path[i + 1] - 1 : 0;
+			weight += base[from] + codes[from * n + to] * step[from];
+		}
+		return weight;
+	}
 	double path_weight = 0.0;
 	size_t x;
-	for (size_t i = 0; i < mGraph.size() - 1; i++)
+	for (size_t i = 0; i < size_t(mSize) - 1; i++)
 	{
-		path_weight += (mGraph)[path[i] - 1][path[i + 1] - 1];
+		path_weight += getWeight(path[i] - 1, path[i + 1] - 1);
 		x = i;
 	}
-	path_weight += (mGraph)[path[x + 1] - 1][0];
+	path_weight += getWeight(path[x + 1] - 1, 0);
 
 	return path_weight;
 }
 
-double Graph::getPathQuality(std::vector<int>& path) {
+double Graph::getPathQuality(const std::vector<int>& path) const {
 	double path_weight = 0.0;
 	size_t x;
-	for (size_t i = 0; i < mGraph.size() - 1; i++)
+	for (size_t i = 0; i < size_t(mSize) - 1; i++)
 	{
-		path_weight += (mGraph)[path[i] - 1][path[i + 1] - 1];
+		path_weight += getWeight(path[i] - 1, path[i + 1] - 1);
 		x = i;
 	}
-	path_weight += (mGraph)[path[x + 1] - 1][0];
+	path_weight += getWeight(path[x + 1] - 1, 0);
+	return getQuality(path_weight);
+}
+double Graph::getQuality(double path_weight) const {
+	refreshBounds();
 	double path_quality = (1 - (path_weight - mMinWeight) / (mMaxWeight - mMinWeight));
 	return path_quality;
 }
@@ -99,30 +882,437 @@ double Graph::getPathQuality(std::vector<int>& path) {
 
 Graph::~Graph()
 {
-	mGraph.clear();
+
 }
 
 
 std::istream& operator>>(std::istream& is, Graph& graph) {
-	int size;
-	is >> size;
-	graph.setSize(size);
-	std::vector<double> edges;
-	edges.resize(size);
-	int i, j, a, b; 
-	double value;
-	for (i = 0; i != (size); i++) {
-		std::fill(edges.begin(), edges.end(), 0.0);
-		for (j = 0; j != (size-1); j++)
-		{
-			is >> a;
-			is >> b;
-			is >> value;
-			edges[b-1] = value;
-			
-		}
-		graph.pushBack(edges, a);
+	std::string error;
+	if (!readEdgeList(is, graph, defaultLoadOptions(), error))
+	{
+		is.setstate(std::ios::failbit);
 	}
 	//graph.setEdges();
 	return is;
-}
\ No newline at end of file
+}
+
+namespace {
+
+//Runs beside the reader, taking each row as soon as it is complete: the
+//row extremes for the bounds and, if asked for, the row's neighbour list.
+class RowPreprocessor
+{
+public:
+	RowPreprocessor(const Graph& graph, int neighbours)
+		:
+		mGraph(graph), mSize(graph.getSize()), mLists(), mRowMax(mSize), mRowMin(mSize),
+		mReady(), mClosed(false), mLock(), mSignal(), mThread()
+	{
+		if (neighbours > 0)
+		{
+			mLists = std::make_shared<NeighbourLists>();
+			mLists->count = std::min(neighbours, mSize - 1);
+			mLists->ids.resize(size_t(mSize) * mLists->count);
+			mLists->weights.resize(size_t(mSize) * mLists->count);
+		}
+		mThread = std::thread([this]() { run(); });
+	}
+	~RowPreprocessor() {
+		finish();
+	}
+	void add(int i) {
+		std::lock_guard<std::mutex> lock(mLock);
+		mReady.push_back(i);
+		mSignal.notify_one();
+	}
+	//Waits for every added row, then hands the results to the graph.
+	void publish(Graph& graph) {
+		finish();
+		//Same extremes setMaxWeight/setMinWeight would find, from the exact
+		//weights even when quantised.
+		double max = graph.getExactRow(0)[1];
+		double min = max;
+		for (int i = 0; i < mSize; i++)
+		{
+			max = std::max(max, mRowMax[i]);
+			if (mRowMin[i] < min)
+			{
+				min = mRowMin[i];
+			}
+		}
+		graph.setBounds(max, min);
+		if (mLists)
+		{
+			graph.setNeighbours(mLists);
+		}
+	}
+private:
+	void finish() {
+		{
+			std::lock_guard<std::mutex> lock(mLock);
+			mClosed = true;
+			mSignal.notify_one();
+		}
+		if (mThread.joinable())
+		{
+			mThread.join();
+		}
+	}
+	void run() {
+		for (;;)
+		{
+			int i;
+			{
+				std::unique_lock<std::mutex> lock(mLock);
+				mSignal.wait(lock, [this]() { return mClosed || !mReady.empty(); });
+				if (mReady.empty())
+				{
+					return;
+				}
+				i = mReady.front();
+				mReady.pop_front();
+			}
+			const double* row = mGraph.getExactRow(i);
+			double max = row[0];
+			double min = std::numeric_limits<double>::infinity();
+			for (int j = 0; j < mSize; j++)
+			{
+				max = std::max(max, row[j]);
+				if (j < mSize - 1 && row[j] > 0.0 && row[j] < min)
+				{
+					min = row[j];
+				}
+			}
+			mRowMax[i] = max;
+			mRowMin[i] = min;
+			if (mLists)
+			{
+				fillNeighbourRow(row, mSize, i, *mLists);
+			}
+		}
+	}
+
+	const Graph& mGraph;
+	int mSize;
+	std::shared_ptr<NeighbourLists> mLists;
+	std::vector<double> mRowMax;
+	std::vector<double> mRowMin;
+	std::deque<int> mReady;
+	bool mClosed;
+	std::mutex mLock;
+	std::condition_variable mSignal;
+	std::thread mThread;
+};
+
+bool loadError(std::string& error, long line, const std::string& problem) {
+	std::ostringstream out;
+	out << "line " << line << ": " << problem;
+	error = out.str();
+	return false;
+}
+
+//Parses "from to weight" with nothing after it but whitespace.
+bool parseEdge(const char* text, long& from, long& to, double& weight) {
+	char* end;
+	errno = 0;
+	from = std::strtol(text, &end, 10);
+	if (end == text)
+	{
+		return false;
+	}
+	text = end;
+	to = std::strtol(text, &end, 10);
+	if (end == text)
+	{
+		return false;
+	}
+	text = end;
+	weight = std::strtod(text, &end);
+	if (end == text || errno != 0)
+	{
+		return false;
+	}
+	while (*end == ' ' || *end == '\t' || *end == '\r')
+	{
+		end++;
+	}
+	return *end == '\0';
+}
+
+bool isBlank(const std::string& line) {
+	return line.find_first_not_of(" \t\r") == std::string::npos;
+}
+
+bool allocateRows(Graph& graph, int size, const LoadOptions& options, std::string& error) {
+	if (options.quantise)
+	{
+		return graph.useQuantised(size, error);
+	}
+	graph.setSize(size);
+	return true;
+}
+
+}
+
+LoadOptions defaultLoadOptions() {
+	LoadOptions options;
+	options.neighbours = 0;
+	options.quantise = false;
+	return options;
+}
+
+bool readEdgeList(std::istream& is, Graph& graph, const LoadOptions& options, std::string& error) {
+	std::string text;
+	long line = 0;
+	while (std::getline(is, text) && isBlank(text))
+	{
+		line++;
+	}
+	line++;
+	char* end;
+	long size = std::strtol(text.c_str(), &end, 10);
+	if (!is || size < 2 || size > 0x7fffffff || !isBlank(end))
+	{
+		return loadError(error, line, "expected a vertex count of at least 2");
+	}
+	int n = size;
+	if (!allocateRows(graph, n, options, error))
+	{
+		return false;
+	}
+	RowPreprocessor preprocess(graph, options.neighbours);
+	std::vector<double> edges(n);
+	std::vector<char> row_done(n, 0);
+	std::vector<char> seen(n, 0);
+	int rows = 0;
+	int row = -1;
+	int count = 0;
+	while (rows < n)
+	{
+		if (!std::getline(is, text))
+		{
+			std::ostringstream problem;
+			problem << "input ended after " << rows << " of " << n << " rows";
+			if (row >= 0)
+			{
+				problem << " (row " << row + 1 << " has " << count << " of " << n - 1 << " edges)";
+			}
+			return loadError(error, line + 1, problem.str());
+		}
+		line++;
+		if (isBlank(text))
+		{
+			continue;
+		}
+		long from, to;
+		double weight;
+		if (!parseEdge(text.c_str(), from, to, weight))
+		{
+			return loadError(error, line, "expected \"from to weight\"");
+		}
+		if (from < 1 || from > n || to < 1 || to > n)
+		{
+			std::ostringstream problem;
+			problem << "vertex out of range 1.." << n;
+			return loadError(error, line, problem.str());
+		}
+		if (row >= 0 && from - 1 != row)
+		{
+			std::ostringstream problem;
+			problem << "row " << row + 1 << " ended after " << count << " of " << n - 1 << " edges";
+			return loadError(error, line, problem.str());
+		}
+		if (row < 0)
+		{
+			if (row_done[from - 1])
+			{
+				std::ostringstream problem;
+				problem << "row " << from << " appears twice";
+				return loadError(error, line, problem.str());
+			}
+			row = from - 1;
+			count = 0;
+			std::fill(edges.begin(), edges.end(), 0.0);
+			std::fill(seen.begin(), seen.end(), 0);
+		}
+		if (to == from)
+		{
+			return loadError(error, line, "edge from a vertex to itself");
+		}
+		if (seen[to - 1])
+		{
+			std::ostringstream problem;
+			problem << "edge " << from << " " << to << " appears twice";
+			return loadError(error, line, problem.str());
+		}
+		if (!std::isfinite(weight))
+		{
+			return loadError(error, line, "weight is not a finite number");
+		}
+		seen[to - 1] = 1;
+		edges[to - 1] = weight;
+		if (++count == n - 1)
+		{
+			graph.setRow(row, edges.data());
+			row_done[row] = 1;
+			preprocess.add(row);
+			row = -1;
+			rows++;
+			if (options.onProgress)
+			{
+				options.onProgress(rows, n);
+			}
+		}
+	}
+	while (std::getline(is, text))
+	{
+		line++;
+		if (!isBlank(text))
+		{
+			std::ostringstream problem;
+			problem << "more than the " << n << " rows in the header";
+			return loadError(error, line, problem.str());
+		}
+	}
+	preprocess.publish(graph);
+	return true;
+}
+
+BinaryHeader makeBinaryHeader(uint32_t kind, uint64_t size) {
+	BinaryHeader header;
+	std::memcpy(header.magic, "TSPB", 4);
+	header.version = 1;
+	header.kind = kind;
+	header.reserved = 0;
+	header.size = size;
+	return header;
+}
+
+bool readBinaryHeader(std::istream& is, BinaryHeader& header) {
+	is.read((char*)&header, sizeof(header));
+	return is && std::memcmp(header.magic, "TSPB", 4) == 0 && header.version == 1;
+}
+
+void writeBinary(std::ostream& os, const Graph& graph) {
+	BinaryHeader header = makeBinaryHeader(BINARY_MATRIX, graph.getSize());
+	os.write((const char*)&header, sizeof(header));
+	for (int i = 0; i < graph.getSize(); i++)
+	{
+		os.write((const char*)graph.getExactRow(i), graph.getSize() * sizeof(double));
+	}
+}
+
+void setCoordinates(Graph& graph, const std::vector<double>& x, const std::vector<double>& y) {
+	int size = x.size();
+	if (double(size) * size * sizeof(double) > getMatrixLimit())
+	{
+		graph.useCoordinates(x, y);
+		return;
+	}
+	graph.setSize(size);
+	std::vector<double> edges(size);
+	for (int i = 0; i < size; i++)
+	{
+		for (int j = 0; j < size; j++)
+		{
+			edges[j] = std::hypot(x[i] - x[j], y[i] - y[j]);
+		}
+		graph.pushBack(edges, i + 1);
+	}
+}
+
+bool loadGraph(std::istream& is, Graph& graph) {
+	std::string error;
+	return loadGraph(is, graph, defaultLoadOptions(), error);
+}
+
+bool loadGraph(std::istream& is, Graph& graph, const LoadOptions& options, std::string& error) {
+	is >> std::ws;
+	int first = is.peek();
+	if (first == 'T')
+	{
+		BinaryHeader header;
+		if (!readBinaryHeader(is, header) || header.size < 2 || header.size > 0x7fffffff)
+		{
+			error = "bad binary header";
+			return false;
+		}
+		int size = header.size;
+		if (header.kind == BINARY_MATRIX)
+		{
+			if (!allocateRows(graph, size, options, error))
+			{
+				return false;
+			}
+			RowPreprocessor preprocess(graph, options.neighbours);
+			std::vector<double> edges(size);
+			for (int i = 0; i < size; i++)
+			{
+				if (!is.read((char*)edges.data(), size * sizeof(double)))
+				{
+					std::ostringstream problem;
+					problem << "binary input ended after " << i << " of " << size << " rows";
+					error = problem.str();
+					return false;
+				}
+				graph.setRow(i, edges.data());
+				preprocess.add(i);
+				if (options.onProgress)
+				{
+					options.onProgress(i + 1, size);
+				}
+			}
+			preprocess.publish(graph);
+			return true;
+		}
+		if (header.kind != BINARY_COORDINATES)
+		{
+			error = "unknown binary graph kind";
+			return false;
+		}
+		std::vector<double> x(size), y(size);
+		for (int i = 0; i < size && is; i++)
+		{
+			double point[2];
+			is.read((char*)point, sizeof(point));
+			x[i] = point[0];
+			y[i] = point[1];
+		}
+		if (!is)
+		{
+			error = "binary input ended inside the points";
+			return false;
+		}
+		setCoordinates(graph, x, y);
+		return true;
+	}
+	if (first == 'c')
+	{
+		std::string word;
+		int size = 0;
+		is >> word >> size;
+		if (word != "coords" || size < 2)
+		{
+			error = "expected \"coords n\" with n of at least 2";
+			return false;
+		}
+		std::vector<double> x(size), y(size);
+		for (int i = 0; i < size; i++)
+		{
+			int id;
+			double px, py;
+			if (!(is >> id >> px >> py) || id < 1 || id > size)
+			{
+				std::ostringstream problem;
+				problem << "bad point " << i + 1 << " of " << size;
+				error = problem.str();
+				return false;
+			}
+			x[id - 1] = px;
+			y[id - 1] = py;
+		}
+		setCoordinates(graph, x, y);
+		return true;
+	}
+	return readEdgeList(is, graph, options, error);
+}
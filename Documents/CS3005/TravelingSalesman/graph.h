@@ -1,8 +1,29 @@
 #pragma once
 #ifndef _GRAPH_H_ 
+#include "matrix.h"
+#include <functional>
 #include <iostream>
+#include <string>
 #include <cstdlib>
+#include <memory>
+#include <stdint.h>
 #include <vector>
+
+//The `count` nearest out-neighbours of every vertex, closest first, as two
+//flat n*count arrays: ids (0-based) and the matching weights.
+struct NeighbourLists
+{
+	int count;
+	std::vector<int> ids;
+	std::vector<double> weights;
+	const int* getIds(int i) const { return &ids[size_t(i) * count]; }
+	const double* getWeights(int i) const { return &weights[size_t(i) * count]; }
+};
+//Fills row i of `lists` from the weights of vertex i.
+void fillNeighbourRow(const double* row, int size, int i, NeighbourLists& lists);
+
+class DistanceCache;
+
 class Graph
 {
 public:
@@ -18,15 +39,149 @@ public:
 	double getMaxWeight() const;
 	double getMinWeight() const;
 	void pushBack(std::vector<double> edges,int i);
-	double getPathWeight(std::vector<int>& path);
-	double getPathQuality(std::vector<int>& path);
+	//Copies n weights into 0-based row i.
+	void setRow(int i, const double* edges);
+	//Sets the bounds from edge extremes found elsewhere, such as by the
+	//streaming loader, instead of by the setMaxWeight/setMinWeight scans.
+	void setBounds(double max_edge, double min_edge);
+	//Takes the bounds of `source` as they are, for a copy of it under other
+	//labels, where a rescan could differ: setMinWeight skips the last column.
+	void copyBounds(const Graph& source);
+	bool hasBounds() const;
+	double getPathWeight(const std::vector<int>& path) const;
+	double getPathQuality(const std::vector<int>& path) const;
+	double getQuality(double path_weight) const;
+	//0-based row access for solvers that walk the matrix directly. On a
+	//quantised graph the row is decoded into a per-thread buffer that the
+	//next getRow call on the same thread overwrites.
+	const double* getRow(int i) const;
+	double getWeight(int i, int j) const;
+	//Hash of the size and every weight, for telling matrices apart.
+	uint64_t getFingerprint() const;
+	//SHA-256 of the same, as hex, where a collision must not happen by
+	//chance; several times slower than getFingerprint.
+	std::string getDigest() const;
+	//Changes one 0-based edge. The min/max bounds are only recomputed, on
+	//their next use, when the update may have shrunk them. Not safe while
+	//another thread is reading the graph.
+	void setWeight(int i, int j, double weight);
+	//Built on first use, in parallel, and shared by every solver; asking
+	//for more neighbours than were built rebuilds with the larger count.
+	//Lists may hold more than k entries. Point-backed graphs search a grid
+	//of the points rather than every row.
+	std::shared_ptr<const NeighbourLists> getNeighbours(int k) const;
+	//As above, but gives up and returns null once `stop` says so; lists
+	//left half built are never shared.
+	std::shared_ptr<const NeighbourLists> getNeighbours(int k, const std::function<bool()>& stop) const;
+	//Installs lists built elsewhere, such as by the streaming loader.
+	void setNeighbours(std::shared_ptr<NeighbourLists> lists);
+	//Makes this an empty quantised graph of `size` vertices for setRow to
+	//fill: each row is stored as one of 65536 evenly spaced levels between
+	//its own smallest and largest weight, a quarter of the memory, and the
+	//exact row goes to a FileMatrix, outside the process, read back only by
+	//the exact accessors. Copies share the exact rows. Returns false if no
+	//file could be made.
+	bool useQuantised(int size, std::string& error);
+	//Quantises a copy of `source`, which need not outlive this graph, for
+	//graphs already in memory; loadGraph can quantise while reading.
+	bool quantiseFrom(const Graph& source, std::string& error);
+	bool isQuantised() const;
+	//Largest difference between a stored and an exact weight, as measured
+	//when each row was encoded.
+	double getQuantisationError() const;
+	//The exact weights of row i when quantised, read into a per-thread
+	//buffer like getRow's, otherwise getRow(i).
+	const double* getExactRow(int i) const;
+	//The path's exact weight when quantised, otherwise the same as
+	//getPathWeight.
+	double getExactPathWeight(const std::vector<int>& path) const;
+	//Backs the graph by points instead of a matrix, for instances too big
+	//to store: weights are Euclidean distances computed on demand and kept
+	//in a small per-vertex cache, so memory stays O(n). setWeight has no
+	//effect on such a graph. The bounds are set from the points in
+	//O(n log n), equal to what the setMaxWeight/setMinWeight scans find;
+	//the fingerprint hashes the points.
+	void useCoordinates(const std::vector<double>& x, const std::vector<double>& y);
+	bool hasCoordinates() const;
+	//Reads the row-major size*size matrix at `rows`, owned elsewhere (such
+	//as a shared memory segment) and outliving this graph, instead of a
+	//private copy. setWeight has no effect on such a graph.
+	void useSharedMatrix(const double* rows, int size);
 private:
-	std::vector< std::vector<double> > mGraph;
+	enum Storage { STORAGE_MATRIX, STORAGE_QUANTISED, STORAGE_COORDINATES, STORAGE_SHARED };
+	double getDistance(int i, int j) const;
+	void setCoordinateBounds();
+	void refreshBounds() const;
+	void buildNeighbourRow(NeighbourLists& lists, int i) const;
+	void updateNeighbours(int i, int j, double weight);
+	void encodeRow(int i, const double* edges);
+	//Row-major n*n, allocated with the current MatrixPlacement.
+	MatrixBuffer mMatrix;
+	//Used instead of mMatrix once quantised: weight = base + code * step,
+	//with a base and step per row.
+	std::vector<uint16_t> mCodes;
+	std::vector<double> mRowBase;
+	std::vector<double> mRowStep;
+	std::vector<double> mRowError;
+	std::shared_ptr<FileMatrix> mExactRows;
+	std::vector<double> mX;
+	std::vector<double> mY;
+	std::shared_ptr<DistanceCache> mCache;
+	const double* mShared;
+	Storage mStorage;
 	std::vector<double> mEdges;
 	int mSize;
-	double mMaxWeight;
-	double mMinWeight;
+	mutable double mMaxWeight;
+	mutable double mMinWeight;
+	//Set once setMaxWeight/setMinWeight have run, so updates know to keep
+	//the bounds current.
+	bool mHasBounds;
+	mutable bool mBoundsStale;
+	mutable std::shared_ptr<NeighbourLists> mNeighbours;
 };
 std::istream& operator>>(std::istream& is, Graph& graph);
 
+//Binary graph files: a BinaryHeader followed by n*n row-major doubles
+//(BINARY_MATRIX) or n x,y pairs of doubles (BINARY_COORDINATES), all in
+//host byte order.
+enum BinaryKind { BINARY_MATRIX = 0, BINARY_COORDINATES = 1 };
+struct BinaryHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t kind;
+	uint32_t reserved;
+	uint64_t size;
+};
+BinaryHeader makeBinaryHeader(uint32_t kind, uint64_t size);
+bool readBinaryHeader(std::istream& is, BinaryHeader& header);
+void writeBinary(std::ostream& os, const Graph& graph);
+//Builds the Euclidean distance matrix of a set of points, or keeps just
+//the points when the matrix would exceed getMatrixLimit().
+void setCoordinates(Graph& graph, const std::vector<double>& x, const std::vector<double>& y);
+
+//Called after every row read with the rows done so far and the total.
+typedef std::function<void(int rows, int total)> LoadProgress;
+struct LoadOptions
+{
+	LoadProgress onProgress;
+	//When non-zero, neighbour lists of this size are built from each row
+	//as it arrives, on a second thread, along with the bounds.
+	int neighbours;
+	//Matrix inputs are encoded row by row into a quantised graph (see
+	//Graph::useQuantised), so the full double matrix is never resident.
+	bool quantise;
+};
+LoadOptions defaultLoadOptions();
+//Streams the text edge list. The matrix is allocated once from the header
+//and every line is checked as it arrives: rows in any order but each
+//exactly once, every other vertex exactly once per row, finite weights.
+//The bounds are set from the rows as they are read. On bad input returns
+//false with the line number and problem in `error`.
+bool readEdgeList(std::istream& is, Graph& graph, const LoadOptions& options, std::string& error);
+//Reads any supported format: the text edge list, text coordinates
+//("coords n" then n "id x y" lines) or binary. Returns false on bad input.
+bool loadGraph(std::istream& is, Graph& graph);
+bool loadGraph(std::istream& is, Graph& graph, const LoadOptions& options, std::string& error);
+
 #endif // !_GRAPH_H_
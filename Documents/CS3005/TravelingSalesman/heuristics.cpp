@@ -0,0 +1,236 @@
+#include "heuristics.h"
+#include "rng.h"
+#include <cstdlib>
+#include <algorithm>
+
+
+std::vector<int> TSPNumericalOrder(Graph& g) {
+	std::vector<int> path;
+	path.push_back(1);
+	int current_vertex = 1;
+	for (size_t i = 0; i < size_t(g.getSize()) - 1; i++)
+	{
+		current_vertex += 1;
+		path.push_back(current_vertex);
+	}
+	return path;
+}
+
+std::vector<int> getRandomCycle(Graph& g) {
+	std::vector<int> path;
+	path = TSPNumericalOrder(g);
+	std::shuffle(path.begin()+1, path.end(), taskRng());
+	return path;
+}
+
+void getRandomSwap(const std::vector<int>& path, int& x, int& y) {
+	if (path.size() < 3)
+	{
+		//Only one movable position: swap it with itself, a no-op.
+		x = y = path.size() - 1;
+		return;
+	}
+	x = taskRng().below(path.size()-1)+1;
+	y = taskRng().below(path.size()-1)+1;
+	if (x==y)
+	{
+		while (x == y)
+		{
+			y = taskRng().below(path.size()-1)+1;
+		}
+	}
+}
+
+std::vector<int> getRandomNeighbor(std::vector<int> path) {
+	int x, y,temp;
+	getRandomSwap(path, x, y);
+	temp = path[x];
+	path[x] = path[y];
+	path[y] = temp;
+	return path;
+
+}
+
+
+int getSwapEdges(int n, int x, int y, int edges[4]) {
+	int all[4] = { (x + n - 1) % n, x, (y + n - 1) % n, y };
+	int count = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		if (std::find(edges, edges + count, all[i]) == edges + count)
+		{
+			edges[count++] = all[i];
+		}
+	}
+	return count;
+}
+
+double getSwapDelta(const Graph& g, std::vector<int>& path, int x, int y) {
+	int n = path.size();
+	int edges[4];
+	int count = getSwapEdges(n, x, y, edges);
+	double before = 0.0;
+	double after = 0.0;
+	for (int i = 0; i < count; i++)
+	{
+		before += g.getWeight(path[edges[i]] - 1, path[(edges[i] + 1) % n] - 1);
+	}
+	std::swap(path[x], path[y]);
+	for (int i = 0; i < count; i++)
+	{
+		after += g.getWeight(path[edges[i]] - 1, path[(edges[i] + 1) % n] - 1);
+	}
+	std::swap(path[x], path[y]);
+	return after - before;
+}
+
+std::vector<int> TSPHillClimb(Graph& g) {
+	SolveControl control(g, SolveClock::time_point::max());
+	return TSPHillClimb(g, control);
+}
+
+std::vector<int> TSPHillClimb(Graph& g, SolveControl& control) {
+
+	std::vector<int> current_path, best_path,temp_path;
+	double best_quality = -1.0;
+	double temp_quality;
+	SolverCounters counters;
+	current_path = getRandomCycle(g);
+	double current_quality = g.getPathQuality(current_path);
+	counters.evaluations++;
+	//Kept if the quality is NaN (every edge the same weight) and the loop
+	//below never runs.
+	best_path = current_path;
+	while (current_quality > best_quality)
+	{
+		best_quality = current_quality;
+		best_path = current_path;
+		if (control.shouldStop())
+		{
+			break;
+		}
+		for (size_t i = 0; i < 100; i++)
+		{
+			temp_path = getRandomNeighbor(current_path);
+			temp_quality = g.getPathQuality(temp_path);
+			counters.evaluations++;
+			if (temp_quality>current_quality)
+			{
+				counters.improvements++;
+				current_quality = temp_quality;
+				current_path = temp_path;
+				break;
+			}
+		}
+	}
+	control.addCounters(counters);
+	control.offer(best_path);
+	return best_path;
+}
+
+std::vector<int> randomRestartHillClimb(Graph& g){
+	SolveControl control(g, SolveClock::time_point::max());
+	return randomRestartHillClimb(g, control);
+}
+
+std::vector<int> randomRestartHillClimb(Graph& g, SolveControl& control){
+	double best_quality = 0.0;
+	double current_quality;
+	std::vector<int> best_path, current_path;
+	SolverCounters counters;
+	for (size_t i = 0; i < 100; i++)
+	{
+		if (i > 0 && control.shouldStop())
+		{
+			break;
+		}
+		counters.restarts++;
+		current_path = TSPHillClimb(g, control);
+		current_quality = g.getPathQuality(current_path);
+		if (best_path.empty() || current_quality>best_quality)
+		{
+			best_path = current_path;
+			best_quality = current_quality;
+		}
+		if (best_quality>=.8)
+		{
+			break;
+		}
+	}
+	control.addCounters(counters);
+	return best_path;
+}
+
+//Path2 Function
+std::vector<int> TSPOddsEvens(Graph& g) {
+	std::vector<int> path;
+	path.push_back(1);
+	int current_vertex = 1;
+	for (size_t i = 0; i < ((size_t(g.getSize()) - 1)/2); i++)
+	{
+		current_vertex += 2;
+		path.push_back(current_vertex);
+	}
+	path.push_back(2);
+	current_vertex = 2;
+	for (size_t i = 0; i < ((size_t(g.getSize()) - 1) / 2); i++)
+	{
+		current_vertex += 2;
+		path.push_back(current_vertex);
+	}
+	return path;
+}
+std::vector<int> TSPThrees(Graph& g) {
+	std::vector<int> path;
+	path.push_back(1);
+	int current_vertex = 1;
+	int last_vertex = g.getSize();
+	while (current_vertex<(last_vertex-2))
+	{
+		current_vertex += 3;
+		path.push_back(current_vertex);
+	}
+		
+	
+	path.push_back(2);
+	current_vertex = 2;
+	while (current_vertex < (last_vertex - 2))
+	{
+		current_vertex += 3;
+		path.push_back(current_vertex);
+	}
+	path.push_back(3);
+	current_vertex = 3;
+	while (current_vertex < (last_vertex - 2))
+	{
+		current_vertex += 3;
+		path.push_back(current_vertex);
+	}
+	return path;
+}
+
+//Best of the three fixed constructions, by quality.
+std::vector<int> TSPBestConstruction(Graph& g) {
+	//1)Vertices in order
+	std::vector<int> path1 = TSPNumericalOrder(g);
+	double path_1_quality = g.getPathQuality(path1);
+	//2)Vertices with all Odds in order than all evens in order
+	std::vector<int> path2 = TSPOddsEvens(g);
+	double path_2_quality = g.getPathQuality(path2);
+	//3)By Threes
+	std::vector<int> path3 = TSPThrees(g);
+	double path_3_quality = g.getPathQuality(path3);
+	double best_quality = path_1_quality;
+	std::vector<int> best_path = path1;
+	if (path_2_quality>best_quality)
+	{
+		best_path = path2;
+		best_quality = path_2_quality;
+	}
+	if (path_3_quality>best_quality)
+	{
+		best_path = path3;
+		best_quality = path_3_quality;
+	}
+	return best_path;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include "anytime.h"
+#include "graph.h"
+#include <vector>
+
+std::vector<int> TSPNumericalOrder(Graph& g);
+std::vector<int> getRandomCycle(Graph& g);
+//Picks the two path positions getRandomNeighbor would swap. With fewer
+//than three vertices there is nothing to swap and x == y.
+void getRandomSwap(const std::vector<int>& path, int& x, int& y);
+std::vector<int> getRandomNeighbor(std::vector<int> path);
+//Start positions of the (at most four) edges a swap of x and y touches.
+int getSwapEdges(int n, int x, int y, int edges[4]);
+//Change in cycle weight from swapping positions x and y, O(1).
+double getSwapDelta(const Graph& g, std::vector<int>& path, int x, int y);
+std::vector<int> TSPHillClimb(Graph& g);
+std::vector<int> TSPHillClimb(Graph& g, SolveControl& control);
+std::vector<int> randomRestartHillClimb(Graph& g);
+std::vector<int> randomRestartHillClimb(Graph& g, SolveControl& control);
+std::vector<int> TSPOddsEvens(Graph& g);
+std::vector<int> TSPThrees(Graph& g);
+std::vector<int> TSPBestConstruction(Graph& g);
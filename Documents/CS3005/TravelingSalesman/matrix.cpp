@@ -0,0 +1,246 @@
+#include "matrix.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <vector>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+namespace {
+
+std::atomic<int> gPlacement(PLACEMENT_DEFAULT);
+std::atomic<size_t> gMatrixLimit(size_t(2) * 1024 * 1024 * 1024);
+
+const size_t HUGE_PAGE = 2 * 1024 * 1024;
+//From <numaif.h>, which is not always installed.
+const int MPOL_INTERLEAVE_MODE = 3;
+
+size_t roundUp(size_t bytes, size_t unit) {
+	return (bytes + unit - 1) / unit * unit;
+}
+
+void* mapPages(size_t bytes, MatrixPlacement placement) {
+	void* pages = MAP_FAILED;
+#if defined(__linux__) && defined(MAP_HUGETLB)
+	if (placement == PLACEMENT_HUGE_PAGES)
+	{
+		pages = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	}
+#endif
+	if (pages == MAP_FAILED)
+	{
+		pages = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (pages == MAP_FAILED)
+		{
+			return NULL;
+		}
+#ifdef MADV_HUGEPAGE
+		madvise(pages, bytes, MADV_HUGEPAGE);
+#endif
+	}
+#if defined(__linux__) && defined(SYS_mbind)
+	if (placement == PLACEMENT_INTERLEAVE)
+	{
+		//Every node; the kernel narrows it to the nodes this process may use.
+		unsigned long nodes = ~0UL;
+		syscall(SYS_mbind, pages, bytes, MPOL_INTERLEAVE_MODE, &nodes, sizeof(nodes) * 8, 0);
+	}
+#endif
+	return pages;
+}
+
+}
+
+void setMatrixPlacement(MatrixPlacement placement) {
+	gPlacement = placement;
+}
+
+MatrixPlacement getMatrixPlacement() {
+	return MatrixPlacement(gPlacement.load());
+}
+
+void setMatrixLimit(size_t bytes) {
+	gMatrixLimit = bytes;
+}
+
+size_t getMatrixLimit() {
+	return gMatrixLimit;
+}
+
+bool parseMatrixPlacement(const std::string& name, MatrixPlacement& placement) {
+	if (name == "default")
+	{
+		placement = PLACEMENT_DEFAULT;
+	}
+	else if (name == "huge")
+	{
+		placement = PLACEMENT_HUGE_PAGES;
+	}
+	else if (name == "interleave")
+	{
+		placement = PLACEMENT_INTERLEAVE;
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+MatrixBuffer::MatrixBuffer()
+	:
+	mData(NULL), mCount(0), mBytes(0), mMapped(false), mPlacement(PLACEMENT_DEFAULT) {
+}
+
+MatrixBuffer::MatrixBuffer(const MatrixBuffer& other)
+	:
+	mData(NULL), mCount(0), mBytes(0), mMapped(false), mPlacement(PLACEMENT_DEFAULT) {
+	allocate(other.mCount, other.mPlacement);
+	std::memcpy(mData, other.mData, mCount * sizeof(double));
+}
+
+MatrixBuffer& MatrixBuffer::operator=(const MatrixBuffer& other) {
+	if (this != &other)
+	{
+		release();
+		allocate(other.mCount, other.mPlacement);
+		std::memcpy(mData, other.mData, mCount * sizeof(double));
+	}
+	return *this;
+}
+
+MatrixBuffer::~MatrixBuffer() {
+	release();
+}
+
+void MatrixBuffer::resize(size_t count) {
+	release();
+	allocate(count, getMatrixPlacement());
+}
+
+size_t MatrixBuffer::size() const {
+	return mCount;
+}
+
+void MatrixBuffer::allocate(size_t count, MatrixPlacement placement) {
+	mCount = count;
+	mPlacement = placement;
+	if (count == 0)
+	{
+		return;
+	}
+	//Below one huge page the placement cannot make a difference.
+	if (placement != PLACEMENT_DEFAULT && count * sizeof(double) >= HUGE_PAGE)
+	{
+		mBytes = roundUp(count * sizeof(double), HUGE_PAGE);
+		mData = (double*)mapPages(mBytes, placement);
+		if (mData != NULL)
+		{
+			mMapped = true;
+			return;
+		}
+	}
+	mBytes = count * sizeof(double);
+	mData = new double[count]();
+}
+
+void MatrixBuffer::release() {
+	if (mMapped)
+	{
+		munmap(mData, mBytes);
+	}
+	else
+	{
+		delete[] mData;
+	}
+	mData = NULL;
+	mCount = 0;
+	mBytes = 0;
+	mMapped = false;
+}
+
+FileMatrix::FileMatrix()
+	:
+	mFile(-1), mCount(0) {
+}
+
+FileMatrix::~FileMatrix() {
+	if (mFile >= 0)
+	{
+		close(mFile);
+	}
+}
+
+bool FileMatrix::open(size_t count, std::string& error) {
+	const char* dir = std::getenv("TMPDIR");
+	std::string path = std::string(dir != NULL && *dir != '\0' ? dir : "/tmp") + "/tsp-exact-XXXXXX";
+	std::vector<char> name(path.begin(), path.end());
+	name.push_back('\0');
+	int fd = mkstemp(name.data());
+	if (fd < 0)
+	{
+		error = path + ": " + std::strerror(errno);
+		return false;
+	}
+	unlink(name.data());
+	int reserved = count > 0 ? posix_fallocate(fd, 0, count * sizeof(double)) : 0;
+	if (reserved != 0)
+	{
+		error = std::string("could not reserve the exact weights: ") + std::strerror(reserved);
+		close(fd);
+		return false;
+	}
+	mFile = fd;
+	mCount = count;
+	return true;
+}
+
+void FileMatrix::write(size_t first, const double* values, size_t count) {
+	const char* bytes = (const char*)values;
+	size_t left = count * sizeof(double);
+	off_t offset = first * sizeof(double);
+	while (left > 0)
+	{
+		ssize_t done = pwrite(mFile, bytes, left, offset);
+		if (done < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (done <= 0)
+		{
+			return;
+		}
+		bytes += done;
+		left -= done;
+		offset += done;
+	}
+}
+
+void FileMatrix::read(size_t first, double* values, size_t count) const {
+	char* bytes = (char*)values;
+	size_t left = count * sizeof(double);
+	off_t offset = first * sizeof(double);
+	while (left > 0)
+	{
+		ssize_t done = pread(mFile, bytes, left, offset);
+		if (done < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (done <= 0)
+		{
+			std::memset(bytes, 0, left);
+			return;
+		}
+		bytes += done;
+		left -= done;
+		offset += done;
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+//Where Graph matrices are allocated. HUGE_PAGES asks for explicit huge
+//pages and falls back to transparent ones; INTERLEAVE also spreads the
+//pages round-robin over every NUMA node, so threads on each socket see the
+//same average latency. Anything the system refuses degrades to plain pages.
+enum MatrixPlacement { PLACEMENT_DEFAULT = 0, PLACEMENT_HUGE_PAGES = 1, PLACEMENT_INTERLEAVE = 2 };
+
+//Process-wide; applies to matrices allocated afterwards.
+void setMatrixPlacement(MatrixPlacement placement);
+MatrixPlacement getMatrixPlacement();
+bool parseMatrixPlacement(const std::string& name, MatrixPlacement& placement);
+//Coordinate inputs whose matrix would take more bytes than this keep only
+//their points (see Graph::useCoordinates). Process-wide, 2 GB by default.
+void setMatrixLimit(size_t bytes);
+size_t getMatrixLimit();
+
+//A zeroed, contiguous array of doubles allocated with the current
+//placement. Copies are deep and keep the placement of the original.
+class MatrixBuffer
+{
+public:
+	MatrixBuffer();
+	MatrixBuffer(const MatrixBuffer& other);
+	MatrixBuffer& operator=(const MatrixBuffer& other);
+	~MatrixBuffer();
+	void resize(size_t count);
+	size_t size() const;
+	double* data() { return mData; }
+	const double* data() const { return mData; }
+	double& operator[](size_t i) { return mData[i]; }
+	double operator[](size_t i) const { return mData[i]; }
+private:
+	void allocate(size_t count, MatrixPlacement placement);
+	void release();
+	double* mData;
+	size_t mCount;
+	size_t mBytes;
+	bool mMapped;
+	MatrixPlacement mPlacement;
+};
+
+//A zeroed array of doubles in an unlinked temporary file under $TMPDIR
+//(or /tmp), reached only through read and write. The values live in the
+//page cache, which the kernel can write back and drop, not in this
+//process. The space is reserved when opened, so writes cannot run out of
+//it. Safe for concurrent use; not copyable.
+class FileMatrix
+{
+public:
+	FileMatrix();
+	~FileMatrix();
+	bool open(size_t count, std::string& error);
+	size_t size() const { return mCount; }
+	//Copy `count` values to or from index `first`.
+	void write(size_t first, const double* values, size_t count);
+	void read(size_t first, double* values, size_t count) const;
+private:
+	FileMatrix(const FileMatrix&);
+	FileMatrix& operator=(const FileMatrix&);
+	int mFile;
+	size_t mCount;
+};
@@ -0,0 +1,82 @@
+#pragma once
+#include "pool.h"
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <vector>
+
+inline unsigned threadCount() {
+	unsigned n = std::thread::hardware_concurrency();
+	if (n == 0)
+	{
+		n = 1;
+	}
+	return n;
+}
+
+//The blocks of one parallelFor call. The caller and helper tasks claim
+//them through `next`; a helper that starts after the last block has been
+//claimed returns without touching `fn`, which may be gone by then.
+struct ParallelBlocks
+{
+	const std::function<void(size_t)>* fn;
+	size_t count;
+	size_t block;
+	size_t total;
+	std::atomic<size_t> next;
+	std::atomic<size_t> done;
+	void run() {
+		for (size_t b = next++; b < total; b = next++)
+		{
+			size_t end = std::min(count, (b + 1) * block);
+			for (size_t i = b * block; i < end; i++)
+			{
+				(*fn)(i);
+			}
+			done++;
+		}
+	}
+};
+
+//Runs fn(i) for every i in [0, count). Work is split into one contiguous
+//block per thread so the same index always lands in the same block. The
+//blocks run on the caller and on helper tasks of the caller's pool, or of
+//sharedPool() outside any pool. A caller waiting for the helpers only runs
+//blocks of its own call, never another queued task, so it cannot pick up
+//a job that holds its locks or outlives its deadline.
+inline void parallelFor(size_t count, const std::function<void(size_t)>& fn) {
+	size_t workers = std::min<size_t>(threadCount(), count);
+	if (workers <= 1)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			fn(i);
+		}
+		return;
+	}
+	std::shared_ptr<ParallelBlocks> blocks = std::make_shared<ParallelBlocks>();
+	blocks->fn = &fn;
+	blocks->count = count;
+	blocks->block = (count + workers - 1) / workers;
+	blocks->total = (count + blocks->block - 1) / blocks->block;
+	blocks->next = 0;
+	blocks->done = 0;
+	ThreadPool* pool = currentPool();
+	if (pool == NULL)
+	{
+		pool = &sharedPool();
+	}
+	for (size_t w = 1; w < blocks->total; w++)
+	{
+		//A full queue just leaves more blocks to the caller.
+		if (!pool->trySubmit([blocks]() { blocks->run(); }))
+		{
+			break;
+		}
+	}
+	blocks->run();
+	while (blocks->done < blocks->total)
+	{
+		std::this_thread::yield();
+	}
+}
@@ -0,0 +1,143 @@
+#include "pool.h"
+#include "parallel.h"
+#include "strategy.h"
+
+namespace {
+
+thread_local ThreadPool* tPool = NULL;
+thread_local size_t tIndex = 0;
+
+}
+
+ThreadPool::ThreadPool(unsigned threads, size_t capacity)
+	:
+	mQueued(0), mCapacity(capacity), mStopping(false), mNext(0) {
+	for (unsigned i = 0; i < threads; i++)
+	{
+		mQueues.push_back(std::unique_ptr<Queue>(new Queue()));
+	}
+	for (unsigned i = 0; i < threads; i++)
+	{
+		mThreads.push_back(std::thread(&ThreadPool::work, this, i));
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStopping = true;
+	}
+	mWake.notify_all();
+	for (size_t i = 0; i < mThreads.size(); i++)
+	{
+		mThreads[i].join();
+	}
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+	push(task, true);
+}
+
+bool ThreadPool::trySubmit(std::function<void()> task) {
+	return push(task, false);
+}
+
+bool ThreadPool::push(std::function<void()>& task, bool wait) {
+	std::string strategy = currentStrategy();
+	std::function<void()> labelled = [strategy, task]() {
+		StrategyScope scope(strategy);
+		task();
+	};
+	size_t home;
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+		if (isWorker())
+		{
+			home = tIndex;
+		}
+		else
+		{
+			if (!wait && mQueued >= mCapacity)
+			{
+				return false;
+			}
+			mRoom.wait(lock, [this]() { return mQueued < mCapacity; });
+			home = mNext++ % mQueues.size();
+		}
+		mQueued++;
+		std::lock_guard<std::mutex> queue_lock(mQueues[home]->mutex);
+		mQueues[home]->tasks.push_back(std::move(labelled));
+	}
+	mWake.notify_one();
+	return true;
+}
+
+bool ThreadPool::isWorker() const {
+	return tPool == this;
+}
+
+unsigned ThreadPool::getThreadCount() const {
+	return mThreads.size();
+}
+
+bool ThreadPool::take(size_t home, std::function<void()>& task) {
+	for (size_t k = 0; k < mQueues.size(); k++)
+	{
+		Queue& queue = *mQueues[(home + k) % mQueues.size()];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.tasks.empty())
+		{
+			continue;
+		}
+		if (k == 0)
+		{
+			task = queue.tasks.back();
+			queue.tasks.pop_back();
+		}
+		else
+		{
+			task = queue.tasks.front();
+			queue.tasks.pop_front();
+		}
+		break;
+	}
+	if (!task)
+	{
+		return false;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mQueued--;
+	}
+	mRoom.notify_one();
+	return true;
+}
+
+void ThreadPool::work(size_t index) {
+	tPool = this;
+	tIndex = index;
+	for (;;)
+	{
+		std::function<void()> task;
+		if (take(index, task))
+		{
+			task();
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(mMutex);
+		mWake.wait(lock, [this]() { return mQueued > 0 || mStopping; });
+		if (mStopping && mQueued == 0)
+		{
+			return;
+		}
+	}
+}
+
+ThreadPool* currentPool() {
+	return tPool;
+}
+
+ThreadPool& sharedPool() {
+	static ThreadPool pool(threadCount(), 64);
+	return pool;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//Fixed set of workers, each with its own task deque. A worker takes its
+//newest task first and, when it has none, steals the oldest task of
+//another worker. Submitting from outside blocks while `capacity` tasks are
+//queued; tasks submitted by a worker go on its own deque unbounded, since
+//blocking there could deadlock the pool. Tasks run under the strategy
+//label of the thread that submitted them.
+class ThreadPool
+{
+public:
+	ThreadPool(unsigned threads, size_t capacity);
+	~ThreadPool();
+	void submit(std::function<void()> task);
+	//submit, except that it gives up instead of blocking on a full queue.
+	bool trySubmit(std::function<void()> task);
+	//True on one of this pool's worker threads.
+	bool isWorker() const;
+	unsigned getThreadCount() const;
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+private:
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque< std::function<void()> > tasks;
+	};
+	bool push(std::function<void()>& task, bool wait);
+	bool take(size_t home, std::function<void()>& task);
+	void work(size_t index);
+	std::vector< std::unique_ptr<Queue> > mQueues;
+	std::vector<std::thread> mThreads;
+	std::mutex mMutex;
+	std::condition_variable mWake;
+	std::condition_variable mRoom;
+	size_t mQueued;
+	size_t mCapacity;
+	bool mStopping;
+	std::atomic<size_t> mNext;
+};
+
+//One pool per process, threadCount() workers, shared by every async solve
+//and by parallelFor.
+ThreadPool& sharedPool();
+//The pool the calling thread works for, NULL outside of any pool.
+ThreadPool* currentPool();
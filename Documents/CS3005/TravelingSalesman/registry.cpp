@@ -0,0 +1,341 @@
+#include "registry.h"
+#include "aco.h"
+#include "atsp.h"
+#include "checkpoint.h"
+#include "decompose.h"
+#include "gls.h"
+#include "gpx.h"
+#include "heuristics.h"
+#include "parallel.h"
+#include "pool.h"
+#include "resultcache.h"
+#include "rng.h"
+#include "tabu.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+
+SolverRegistry& SolverRegistry::instance() {
+	static SolverRegistry registry;
+	return registry;
+}
+
+SolverRegistry::SolverRegistry()
+	:
+	mEntries() {
+	add("numerical", "vertices in numerical order", false, [](Graph& g, SolveControl& control) {
+		std::vector<int> path = TSPNumericalOrder(g);
+		control.offer(path);
+		return path;
+	});
+	add("oddsevens", "odd vertices, then even vertices", false, [](Graph& g, SolveControl& control) {
+		std::vector<int> path = TSPOddsEvens(g);
+		control.offer(path);
+		return path;
+	});
+	add("threes", "vertices by threes", false, [](Graph& g, SolveControl& control) {
+		std::vector<int> path = TSPThrees(g);
+		control.offer(path);
+		return path;
+	});
+	add("constructions", "best of numerical, oddsevens and threes", false, [](Graph& g, SolveControl& control) {
+		std::vector<int> path = TSPBestConstruction(g);
+		control.offer(path);
+		return path;
+	});
+	add("hillclimb", "random restart hill climbing", false, [](Graph& g, SolveControl& control) {
+		return randomRestartHillClimb(g, control);
+	});
+	add("guided", "guided local search: penalise local optima instead of restarting", false, [](Graph& g, SolveControl& control) {
+		return TSPGuidedLocalSearch(g, defaultGuidedParams(g), control);
+	});
+	add("merge", "parallel hill climbs merged by partition crossover", false, [](Graph& g, SolveControl& control) {
+		return restartAndMerge(g, 100, control);
+	});
+	add("tabu", "tabu search", false, [](Graph& g, SolveControl& control) {
+		return TSPTabuSearch(g, defaultTabuParams(g), control);
+	});
+	add("aco", "max-min ant system", false, [](Graph& g, SolveControl& control) {
+		return TSPAntColony(g, defaultACOParams(g), control);
+	});
+	add("decompose", "cluster, solve clusters in parallel, stitch", false, [](Graph& g, SolveControl& control) {
+		return TSPDecompose(g, defaultDecomposeParams(), control);
+	});
+	add("atsp", "reversal-free local search for asymmetric instances", false, [](Graph& g, SolveControl& control) {
+		return TSPAsymmetricSearch(g, control);
+	});
+	add("anytime", "tabu restarts merged into the incumbent until the budget runs out", true, solveAnytime);
+}
+
+void SolverRegistry::add(const std::string& name, const std::string& description, bool needs_budget, Solver solve) {
+	SolverEntry entry;
+	entry.name = name;
+	entry.description = description;
+	entry.needsBudget = needs_budget;
+	entry.solve = solve;
+	mEntries.push_back(entry);
+}
+
+const SolverEntry* SolverRegistry::find(const std::string& name) const {
+	for (size_t i = 0; i < mEntries.size(); i++)
+	{
+		if (mEntries[i].name == name)
+		{
+			return &mEntries[i];
+		}
+	}
+	return NULL;
+}
+
+const std::vector<SolverEntry>& SolverRegistry::getEntries() const {
+	return mEntries;
+}
+
+SolveConfig defaultSolveConfig() {
+	SolveConfig config;
+	config.solvers.push_back("constructions");
+	config.budget = 0;
+	config.race = false;
+	config.seed = std::chrono::system_clock::now().time_since_epoch().count();
+	config.deterministic = false;
+	config.checkpointInterval = 5.0;
+	config.quantise = false;
+	config.refreshCache = false;
+	return config;
+}
+
+std::vector<std::string> splitSolverList(const std::string& list) {
+	std::vector<std::string> names;
+	std::istringstream in(list);
+	std::string name;
+	while (std::getline(in, name, ','))
+	{
+		if (!name.empty())
+		{
+			names.push_back(name);
+		}
+	}
+	return names;
+}
+
+std::string checkSolveConfig(const SolveConfig& config) {
+	if (config.solvers.empty())
+	{
+		return "no solver given";
+	}
+	if (config.deterministic && (config.budget > 0 || config.race))
+	{
+		return "a fixed --seed cannot be combined with --budget or --race";
+	}
+	if (!config.checkpoint.empty() && (config.solvers.size() != 1 || config.solvers[0] != "anytime"))
+	{
+		return "--checkpoint only works with --solver anytime on its own";
+	}
+	for (size_t i = 0; i < config.solvers.size(); i++)
+	{
+		const SolverEntry* entry = SolverRegistry::instance().find(config.solvers[i]);
+		if (entry == NULL)
+		{
+			return "unknown solver " + config.solvers[i];
+		}
+		if (entry->needsBudget && config.budget <= 0)
+		{
+			return "solver " + entry->name + " needs --budget";
+		}
+	}
+	return "";
+}
+
+namespace {
+
+//A solver that gave up without a tour (say on a graph where every tour
+//has the same weight) leaves the best fixed construction instead.
+std::vector<int> orConstruction(Graph& g, SolveControl& control, const std::vector<int>& path) {
+	if (!path.empty())
+	{
+		return path;
+	}
+	std::vector<int> construction = TSPBestConstruction(g);
+	control.offer(construction);
+	return construction;
+}
+
+}
+
+std::vector<int> runPortfolio(Graph& g, const std::vector<std::string>& solvers, bool race, SolveControl& control) {
+	std::vector<const SolverEntry*> entries;
+	for (size_t i = 0; i < solvers.size(); i++)
+	{
+		const SolverEntry* entry = SolverRegistry::instance().find(solvers[i]);
+		if (entry != NULL)
+		{
+			entries.push_back(entry);
+		}
+	}
+	if (entries.size() == 1)
+	{
+		StrategyScope scope(entries[0]->name);
+		entries[0]->solve(g, control);
+		return orConstruction(g, control, control.getBestPath());
+	}
+	//Every solver shares the control, so cancelling its token when the
+	//first one finishes stops the rest at their next poll. Each solver gets
+	//its own RNG stream and the winner is picked by (weight, position in
+	//the portfolio), so the result does not depend on which thread
+	//finishes first.
+	std::vector< std::vector<int> > results(entries.size());
+	uint64_t seed = taskRng().next();
+	parallelFor(entries.size(), [&entries, &results, race, seed, &g, &control](size_t i) {
+		StrategyScope scope(entries[i]->name);
+		RngScope rng(seed, i);
+		results[i] = entries[i]->solve(g, control);
+		if (race)
+		{
+			control.getToken().cancel();
+		}
+	});
+	//On a quantised graph near-ties are only settled by the exact weights.
+	int best = -1;
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		if (!results[i].empty() && (best < 0 || g.getExactPathWeight(results[i]) < g.getExactPathWeight(results[best])))
+		{
+			best = i;
+		}
+	}
+	return orConstruction(g, control, best < 0 ? std::vector<int>() : results[best]);
+}
+
+//Runs the anytime search from the checkpoint, if there is a matching one,
+//with whatever budget the earlier runs left over.
+std::vector<int> resumeFromCheckpoint(Graph& g, const SolveConfig& config, SolveControl& control) {
+	uint64_t fingerprint = g.getFingerprint();
+	AnytimeState state;
+	bool resumed = readCheckpoint(config.checkpoint, g, fingerprint, state);
+	CheckpointWriter writer(config.checkpoint, fingerprint, config.checkpointInterval);
+	StrategyScope scope("anytime");
+	return resumeAnytime(g, control, resumed ? &state : NULL, [&writer](const AnytimeState& s) {
+		writer.submit(s);
+	});
+}
+
+std::vector<int> solveWithConfig(Graph& g, const SolveConfig& config, std::string* telemetry) {
+	if (!config.resultCache.empty())
+	{
+		std::string key = getResultKey(g, config);
+		std::vector<int> cached;
+		bool hit = readCachedResult(config.resultCache, key, g, cached);
+		if (hit && !config.refreshCache)
+		{
+			if (telemetry != NULL)
+			{
+				SolveControl control(g, SolveClock::now());
+				StrategyScope scope("cache");
+				control.offer(cached);
+				std::ostringstream json;
+				writeTelemetryJson(json, control);
+				*telemetry = json.str();
+			}
+			return cached;
+		}
+		SolveConfig inner = config;
+		inner.resultCache.clear();
+		std::vector<int> path = solveWithConfig(g, inner, telemetry);
+		if (hit && g.getPathWeight(cached) <= g.getPathWeight(path))
+		{
+			return cached;
+		}
+		std::string error;
+		if (!writeCachedResult(config.resultCache, key, g, path, error) && !error.empty())
+		{
+			std::cerr << "could not write result cache: " << error << std::endl;
+		}
+		return path;
+	}
+	if (config.quantise && !g.hasCoordinates() && !g.isQuantised())
+	{
+		Graph quantised;
+		std::string error;
+		if (quantised.quantiseFrom(g, error))
+		{
+			return solveWithConfig(quantised, config, telemetry);
+		}
+		std::cerr << "could not quantise: " << error << std::endl;
+	}
+	long budget = config.budget;
+	if (!config.checkpoint.empty())
+	{
+		AnytimeState state;
+		if (readCheckpoint(config.checkpoint, g, g.getFingerprint(), state))
+		{
+			budget = std::max(1L, budget - (long)(state.elapsed * 1000));
+		}
+	}
+	SolveClock::time_point deadline = SolveClock::time_point::max();
+	if (budget > 0)
+	{
+		deadline = SolveClock::now() + std::chrono::milliseconds(budget);
+	}
+	ImproveCallback on_improve = config.onImprove;
+	if (on_improve && g.isQuantised())
+	{
+		ImproveCallback outer = config.onImprove;
+		const Graph* quantised = &g;
+		on_improve = [outer, quantised](const std::vector<int>& path, double, double) {
+			double weight = quantised->getExactPathWeight(path);
+			outer(path, weight, quantised->getQuality(weight));
+		};
+	}
+	SolveControl control(g, deadline, CancelToken(), on_improve);
+	RngScope rng(config.seed, 0);
+	std::vector<int> path;
+	if (config.checkpoint.empty())
+	{
+		path = runPortfolio(g, config.solvers, config.race, control);
+	}
+	else
+	{
+		path = resumeFromCheckpoint(g, config, control);
+	}
+	if (g.isQuantised() && !path.empty())
+	{
+		//No edge may decode further from its exact weight than was measured
+		//while encoding.
+		double exact = g.getExactPathWeight(path);
+		double drift = std::fabs(exact - g.getPathWeight(path));
+		double bound = g.getQuantisationError() * g.getSize();
+		if (drift > bound + 1e-9 * std::fabs(exact))
+		{
+			std::cerr << "quantised tour weight is off by " << drift << ", beyond the bound of " << bound << std::endl;
+		}
+	}
+	if (telemetry != NULL)
+	{
+		std::ostringstream json;
+		writeTelemetryJson(json, control);
+		*telemetry = json.str();
+	}
+	return path;
+}
+
+std::future< std::vector<int> > solveAsync(std::shared_ptr<Graph> g, const SolveConfig& config) {
+	std::shared_ptr< std::promise< std::vector<int> > > promise = std::make_shared< std::promise< std::vector<int> > >();
+	solveAsync(g, config, [promise](const std::vector<int>& path) {
+		promise->set_value(path);
+	});
+	return promise->get_future();
+}
+
+void solveAsync(std::shared_ptr<Graph> g, const SolveConfig& config, SolvedCallback on_solved) {
+	SolveClock::time_point submitted = SolveClock::now();
+	sharedPool().submit([g, config, on_solved, submitted]() {
+		SolveConfig remaining = config;
+		if (remaining.budget > 0)
+		{
+			long waited = std::chrono::duration_cast<std::chrono::milliseconds>(SolveClock::now() - submitted).count();
+			remaining.budget = std::max(1L, remaining.budget - waited);
+		}
+		on_solved(solveWithConfig(*g, remaining));
+	});
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include "anytime.h"
+#include "graph.h"
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+typedef std::function<std::vector<int>(Graph& g, SolveControl& control)> Solver;
+
+struct SolverEntry
+{
+	std::string name;
+	std::string description;
+	//Solvers that only stop on the deadline cannot run unbounded.
+	bool needsBudget;
+	Solver solve;
+};
+
+//Named strategies, so portfolios can be picked at run time. The built-in
+//heuristics are registered on first use.
+class SolverRegistry
+{
+public:
+	static SolverRegistry& instance();
+	void add(const std::string& name, const std::string& description, bool needs_budget, Solver solve);
+	const SolverEntry* find(const std::string& name) const;
+	const std::vector<SolverEntry>& getEntries() const;
+private:
+	SolverRegistry();
+	std::vector<SolverEntry> mEntries;
+};
+
+struct SolveConfig
+{
+	std::vector<std::string> solvers;
+	//Milliseconds, 0 for no limit.
+	long budget;
+	//Stop the whole portfolio as soon as any one solver finishes.
+	bool race;
+	//Every solve starts from RNG stream (seed, 0), so a given input, seed
+	//and solver list always gives the same tour, whatever the thread count.
+	uint64_t seed;
+	//Set when the seed was given explicitly; rules out wall-clock limits.
+	bool deterministic;
+	//When set, an anytime solve resumes from and saves to this file.
+	std::string checkpoint;
+	//Minimum seconds between checkpoint writes.
+	double checkpointInterval;
+	//Search 16-bit quantised weights; the candidate tours are compared on
+	//the exact weights. A graph loaded with LoadOptions::quantise is
+	//searched as it is, any other matrix is quantised into a copy first.
+	//Ignored on point-backed graphs, already O(n).
+	bool quantise;
+	//Directory of the result cache, empty for none. A hit is returned
+	//without solving unless refreshCache is set; a refresh only replaces
+	//the entry when it finds a better tour.
+	std::string resultCache;
+	bool refreshCache;
+	//Told of every improvement as it is found, in the input's labels and
+	//with exact weights, even when quantised.
+	ImproveCallback onImprove;
+};
+
+SolveConfig defaultSolveConfig();
+std::vector<std::string> splitSolverList(const std::string& list);
+//Empty if the config can run, otherwise what is wrong with it.
+std::string checkSolveConfig(const SolveConfig& config);
+//Runs every solver of the portfolio as a parallelFor block against one
+//shared incumbent and returns the best tour any of them found. With fewer
+//threads than solvers some blocks run one after another, the later ones
+//getting whatever budget the earlier left.
+std::vector<int> runPortfolio(Graph& g, const std::vector<std::string>& solvers, bool race, SolveControl& control);
+//When `telemetry` is given it receives the solve's telemetry JSON.
+std::vector<int> solveWithConfig(Graph& g, const SolveConfig& config, std::string* telemetry = NULL);
+//Queues the solve on sharedPool() and returns at once. The budget counts
+//from the call, so time spent queued comes out of it; blocks only while
+//the pool's queue is full.
+std::future< std::vector<int> > solveAsync(std::shared_ptr<Graph> g, const SolveConfig& config);
+typedef std::function<void(const std::vector<int>& path)> SolvedCallback;
+//As above, but hands the tour to `on_solved` on the pool thread that
+//found it instead of through a future.
+void solveAsync(std::shared_ptr<Graph> g, const SolveConfig& config, SolvedCallback on_solved);
@@ -0,0 +1,84 @@
+#include "relabel.h"
+
+namespace {
+
+//Neighbours per vertex tried before falling back to the lowest unvisited
+//id.
+const int NEIGHBOURS = 10;
+
+}
+
+std::vector<int> getLocalityOrder(const Graph& g) {
+	int n = g.getSize();
+	std::vector<int> order;
+	order.reserve(n);
+	if (n == 0)
+	{
+		return order;
+	}
+	std::shared_ptr<const NeighbourLists> lists = g.getNeighbours(NEIGHBOURS);
+	std::vector<char> visited(n, 0);
+	int current = 0;
+	int unvisited = 1;
+	visited[0] = 1;
+	order.push_back(0);
+	for (int step = 1; step < n; step++)
+	{
+		int next = -1;
+		const int* nearest = lists->getIds(current);
+		for (int c = 0; c < lists->count && next < 0; c++)
+		{
+			if (!visited[nearest[c]])
+			{
+				next = nearest[c];
+			}
+		}
+		if (next < 0)
+		{
+			while (visited[unvisited])
+			{
+				unvisited++;
+			}
+			next = unvisited;
+		}
+		visited[next] = 1;
+		order.push_back(next);
+		current = next;
+	}
+	return order;
+}
+
+Graph relabelGraph(const Graph& g, const std::vector<int>& order) {
+	int n = order.size();
+	Graph relabelled;
+	relabelled.setSize(n);
+	std::vector<double> edges(n);
+	for (int i = 0; i < n; i++)
+	{
+		const double* row = g.getRow(order[i]);
+		for (int j = 0; j < n; j++)
+		{
+			edges[j] = row[order[j]];
+		}
+		relabelled.pushBack(edges, i + 1);
+	}
+	if (g.hasBounds())
+	{
+		relabelled.copyBounds(g);
+	}
+	else
+	{
+		relabelled.setMaxWeight();
+		relabelled.setMinWeight();
+	}
+	return relabelled;
+}
+
+std::vector<int> restoreLabels(const std::vector<int>& path, const std::vector<int>& order) {
+	std::vector<int> restored(path.size());
+	for (size_t i = 0; i < path.size(); i++)
+	{
+		restored[i] = order[path[i] - 1] + 1;
+	}
+	return restored;
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include "graph.h"
+#include <vector>
+
+//Vertex renumbering for memory locality, measured by TSP-bench --locality.
+//The solvers do not use it: at n=4000 and 8000 the relabelled tour walk was
+//9% and 1% faster, and tabu and guided search moved no more than the noise.
+
+//0-based vertex order from a nearest-neighbour walk starting at vertex 0,
+//so cities that are close get close ids. A vertex whose neighbours are all
+//visited jumps to the lowest unvisited id, so the walk is O(n k).
+std::vector<int> getLocalityOrder(const Graph& g);
+//The graph with vertex order[k] renumbered to k. order[0] must be 0 so
+//paths still start at vertex 1. Keeps the bounds of `g`, so qualities are
+//the same on both.
+Graph relabelGraph(const Graph& g, const std::vector<int>& order);
+//Maps a path on the relabelled graph back to the original ids.
+std::vector<int> restoreLabels(const std::vector<int>& path, const std::vector<int>& order);
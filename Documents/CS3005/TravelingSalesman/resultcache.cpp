@@ -0,0 +1,158 @@
+#include "resultcache.h"
+#include "registry.h"
+#include "sha256.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+std::string getEntryPath(const std::string& directory, const std::string& key) {
+	return directory + "/" + key + ".tour";
+}
+
+//mkdir -p: creates every missing directory along the path.
+bool makeDirectories(const std::string& path) {
+	for (size_t end = path.find('/', 1); ; end = path.find('/', end + 1))
+	{
+		std::string prefix = path.substr(0, end);
+		if (!prefix.empty() && mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST)
+		{
+			return false;
+		}
+		if (end == std::string::npos)
+		{
+			return true;
+		}
+	}
+}
+
+//Holds an exclusive flock on the cache directory while in scope, so the
+//read-compare-rename of one writer cannot interleave with another's, in
+//this process or any other.
+class DirectoryLock
+{
+public:
+	explicit DirectoryLock(const std::string& directory)
+		:
+		mFd(open(directory.c_str(), O_RDONLY)) {
+		if (mFd >= 0 && flock(mFd, LOCK_EX) != 0)
+		{
+			close(mFd);
+			mFd = -1;
+		}
+	}
+	~DirectoryLock() {
+		if (mFd >= 0)
+		{
+			close(mFd);
+		}
+	}
+	bool isLocked() const {
+		return mFd >= 0;
+	}
+	DirectoryLock(const DirectoryLock&) = delete;
+	DirectoryLock& operator=(const DirectoryLock&) = delete;
+private:
+	int mFd;
+};
+
+}
+
+std::string getResultKey(const Graph& g, const SolveConfig& config) {
+	std::ostringstream settings;
+	for (size_t i = 0; i < config.solvers.size(); i++)
+	{
+		settings << config.solvers[i] << ',';
+	}
+	settings << " budget=" << config.budget << " race=" << config.race;
+	settings << " quantise=" << config.quantise;
+	if (config.deterministic)
+	{
+		settings << " seed=" << config.seed;
+	}
+	std::string digest = g.getDigest() + settings.str();
+	Sha256 key;
+	key.update(digest.data(), digest.size());
+	return key.hexDigest();
+}
+
+bool readCachedResult(const std::string& directory, const std::string& key, const Graph& g, std::vector<int>& path) {
+	std::ifstream in(getEntryPath(directory, key).c_str());
+	int size;
+	double weight;
+	if (!(in >> size >> weight) || size != g.getSize())
+	{
+		return false;
+	}
+	std::vector<int> tour(size);
+	std::vector<char> seen(size + 1, 0);
+	for (int i = 0; i < size; i++)
+	{
+		if (!(in >> tour[i]) || tour[i] < 1 || tour[i] > size || seen[tour[i]])
+		{
+			return false;
+		}
+		seen[tour[i]] = 1;
+	}
+	if (tour[0] != 1)
+	{
+		return false;
+	}
+	path = tour;
+	return true;
+}
+
+bool writeCachedResult(const std::string& directory, const std::string& key, const Graph& g, const std::vector<int>& path,
+	std::string& error) {
+	error.clear();
+	if (!makeDirectories(directory))
+	{
+		error = directory + ": " + std::strerror(errno);
+		return false;
+	}
+	DirectoryLock lock(directory);
+	if (!lock.isLocked())
+	{
+		error = directory + ": " + std::strerror(errno);
+		return false;
+	}
+	double weight = g.getPathWeight(path);
+	std::vector<int> stored;
+	if (readCachedResult(directory, key, g, stored) && g.getPathWeight(stored) <= weight)
+	{
+		return false;
+	}
+	std::ostringstream temp;
+	temp << getEntryPath(directory, key) << ".tmp" << getpid() << '.' << std::hash<std::thread::id>()(std::this_thread::get_id());
+	{
+		std::ofstream out(temp.str().c_str());
+		out << path.size() << ' ' << std::setprecision(17) << weight << '\n';
+		for (size_t i = 0; i < path.size(); i++)
+		{
+			out << path[i] << (i + 1 < path.size() ? ' ' : '\n');
+		}
+		if (!out.flush())
+		{
+			error = temp.str() + ": write failed";
+			std::remove(temp.str().c_str());
+			return false;
+		}
+	}
+	if (std::rename(temp.str().c_str(), getEntryPath(directory, key).c_str()) != 0)
+	{
+		error = getEntryPath(directory, key) + ": " + std::strerror(errno);
+		std::remove(temp.str().c_str());
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include "graph.h"
+#include <string>
+#include <vector>
+
+struct SolveConfig;
+
+//On-disk cache of best tours: one file per (graph, config) key in a
+//directory, each holding the tour and its weight as text. Files are
+//replaced by rename, so concurrent runs never see a half-written entry,
+//and writers hold a flock on the directory, so a worse tour can never
+//replace a better one that landed in between.
+
+//64 hex digits: SHA-256 of the graph's digest and of everything in the
+//config that changes the result. The seed only counts when it was given.
+std::string getResultKey(const Graph& g, const SolveConfig& config);
+//False if there is no entry or it is not a valid tour of g.
+bool readCachedResult(const std::string& directory, const std::string& key, const Graph& g, std::vector<int>& path);
+//Stores path unless the entry already holds a tour at least as good,
+//creating the directory if needed. Returns true if the entry was written;
+//`error` is left empty unless writing failed.
+bool writeCachedResult(const std::string& directory, const std::string& key, const Graph& g, const std::vector<int>& path,
+	std::string& error);
@@ -0,0 +1,77 @@
+#include "rng.h"
+#include <atomic>
+#include <chrono>
+
+namespace {
+
+std::atomic<uint64_t> gThreads(0);
+
+CounterRng& defaultRng() {
+	thread_local CounterRng rng(std::chrono::steady_clock::now().time_since_epoch().count(), gThreads++);
+	return rng;
+}
+
+thread_local CounterRng* tCurrent = 0;
+
+}
+
+CounterRng::CounterRng(uint64_t seed, uint64_t stream)
+	:
+	mKey(mix64(seed ^ mix64(stream + 0x9e3779b97f4a7c15ULL))), mCounter(0) {
+}
+
+CounterRng::CounterRng()
+	:
+	mKey(0), mCounter(0) {
+}
+
+uint64_t CounterRng::getKey() const {
+	return mKey;
+}
+
+uint64_t CounterRng::getCounter() const {
+	return mCounter;
+}
+
+CounterRng CounterRng::fromState(uint64_t key, uint64_t counter) {
+	CounterRng rng;
+	rng.mKey = key;
+	rng.mCounter = counter;
+	return rng;
+}
+
+uint64_t CounterRng::next() {
+	return mix64(mKey + 0x9e3779b97f4a7c15ULL * ++mCounter);
+}
+
+uint32_t CounterRng::below(uint32_t bound) {
+	return uint32_t(((next() >> 32) * bound) >> 32);
+}
+
+double CounterRng::unit() {
+	return (next() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+CounterRng& taskRng() {
+	return tCurrent != 0 ? *tCurrent : defaultRng();
+}
+
+RngScope::RngScope(uint64_t seed, uint64_t stream)
+	:
+	mRng(seed, stream), mPrevious(tCurrent) {
+	tCurrent = &mRng;
+}
+
+RngScope::RngScope(const CounterRng& rng)
+	:
+	mRng(rng), mPrevious(tCurrent) {
+	tCurrent = &mRng;
+}
+
+CounterRng& RngScope::get() {
+	return mRng;
+}
+
+RngScope::~RngScope() {
+	tCurrent = mPrevious;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <stdint.h>
+
+inline uint64_t mix64(uint64_t x) {
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebULL;
+	x ^= x >> 31;
+	return x;
+}
+
+//Counter-based generator: output k of stream (seed, stream) is a hash of
+//(seed, stream, k), so every task can be given its own reproducible
+//stream no matter which thread runs it or in what order.
+class CounterRng
+{
+public:
+	typedef uint64_t result_type;
+	CounterRng(uint64_t seed, uint64_t stream);
+	uint64_t next();
+	//Uniform in [0, bound).
+	uint32_t below(uint32_t bound);
+	double unit();
+	static constexpr result_type min() { return 0; }
+	static constexpr result_type max() { return ~result_type(0); }
+	result_type operator()() { return next(); }
+	//Raw state, for checkpoints.
+	uint64_t getKey() const;
+	uint64_t getCounter() const;
+	static CounterRng fromState(uint64_t key, uint64_t counter);
+private:
+	CounterRng();
+	uint64_t mKey;
+	uint64_t mCounter;
+};
+
+//The generator the heuristics draw from on the calling thread: the one
+//installed by the innermost RngScope, or a per-thread default.
+CounterRng& taskRng();
+
+class RngScope
+{
+public:
+	RngScope(uint64_t seed, uint64_t stream);
+	RngScope(const CounterRng& rng);
+	~RngScope();
+	CounterRng& get();
+	RngScope(const RngScope&) = delete;
+	RngScope& operator=(const RngScope&) = delete;
+private:
+	CounterRng mRng;
+	CounterRng* mPrevious;
+};
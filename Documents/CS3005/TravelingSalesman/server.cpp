@@ -0,0 +1,222 @@
+#include "server.h"
+#include "batch.h"
+#include "pool.h"
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+GraphCache::GraphCache(size_t capacity)
+	:
+	mCapacity(capacity), mEntries(), mIndex(), mMutex() {
+}
+
+std::shared_ptr<Graph> GraphCache::find(uint64_t key) {
+	std::lock_guard<std::mutex> lock(mMutex);
+	std::unordered_map<uint64_t, Entries::iterator>::iterator it = mIndex.find(key);
+	if (it == mIndex.end())
+	{
+		return std::shared_ptr<Graph>();
+	}
+	mEntries.splice(mEntries.begin(), mEntries, it->second);
+	return it->second->second;
+}
+
+void GraphCache::insert(uint64_t key, std::shared_ptr<Graph> graph) {
+	std::lock_guard<std::mutex> lock(mMutex);
+	std::unordered_map<uint64_t, Entries::iterator>::iterator it = mIndex.find(key);
+	if (it != mIndex.end())
+	{
+		mEntries.splice(mEntries.begin(), mEntries, it->second);
+		return;
+	}
+	mEntries.push_front(std::make_pair(key, graph));
+	mIndex[key] = mEntries.begin();
+	while (mEntries.size() > mCapacity)
+	{
+		mIndex.erase(mEntries.back().first);
+		mEntries.pop_back();
+	}
+}
+
+//FNV-1a over the raw request bytes.
+uint64_t contentHash(const std::string& text) {
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < text.size(); i++)
+	{
+		hash ^= (unsigned char)text[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+namespace {
+
+const int READ_TIMEOUT = 30;
+
+std::string toHex(uint64_t value) {
+	char buffer[17];
+	std::snprintf(buffer, sizeof(buffer), "%016llx", (unsigned long long)value);
+	return buffer;
+}
+
+bool readAll(int fd, std::string& text) {
+	char buffer[1 << 16];
+	for (;;)
+	{
+		ssize_t got = read(fd, buffer, sizeof(buffer));
+		if (got == 0)
+		{
+			return true;
+		}
+		if (got < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			return false;
+		}
+		text.append(buffer, got);
+	}
+}
+
+void writeAll(int fd, const std::string& text) {
+	size_t sent = 0;
+	while (sent < text.size())
+	{
+		ssize_t put = write(fd, text.data() + sent, text.size() - sent);
+		if (put < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			return;
+		}
+		sent += put;
+	}
+}
+
+void reply(int client, const std::string& text) {
+	writeAll(client, text);
+	close(client);
+}
+
+//Answers errors at once; otherwise queues the solve with the reply
+//chained onto it, so no thread waits for the tour.
+void handleRequest(int client, const std::string& request, GraphCache& cache, const SolveConfig& config) {
+	std::istringstream in(request);
+	std::string word;
+	in >> word;
+	uint64_t key;
+	std::shared_ptr<Graph> graph;
+	if (word == "cached")
+	{
+		std::string hex;
+		in >> hex;
+		key = std::strtoull(hex.c_str(), NULL, 16);
+		graph = cache.find(key);
+		if (!graph)
+		{
+			reply(client, "error: unknown graph " + hex + "\n");
+			return;
+		}
+	}
+	else
+	{
+		key = contentHash(request);
+		graph = cache.find(key);
+		if (!graph)
+		{
+			std::shared_ptr<Graph> parsed = std::make_shared<Graph>();
+			std::istringstream body(request);
+			std::string error;
+			LoadOptions load = defaultLoadOptions();
+			load.quantise = config.quantise;
+			if (!loadGraph(body, *parsed, load, error))
+			{
+				reply(client, "error: could not read graph: " + error + "\n");
+				return;
+			}
+			if (!parsed->hasBounds())
+			{
+				parsed->setMaxWeight();
+				parsed->setMinWeight();
+			}
+			cache.insert(key, parsed);
+			graph = parsed;
+		}
+	}
+	solveAsync(graph, config, [client, key, graph](const std::vector<int>& path) {
+		std::ostringstream out;
+		out << "hash " << toHex(key) << '\n';
+		writeResult(out, *graph, path);
+		reply(client, out.str());
+	});
+}
+
+}
+
+int runServer(const std::string& socket_path, size_t cache_capacity, const SolveConfig& config) {
+	std::signal(SIGPIPE, SIG_IGN);
+	sockaddr_un address;
+	std::memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (socket_path.size() >= sizeof(address.sun_path))
+	{
+		std::cerr << "socket path too long: " << socket_path << std::endl;
+		return 1;
+	}
+	std::strcpy(address.sun_path, socket_path.c_str());
+
+	int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	unlink(socket_path.c_str());
+	if (listener < 0 || bind(listener, (sockaddr*)&address, sizeof(address)) < 0 || listen(listener, 64) < 0)
+	{
+		std::cerr << "could not listen on " << socket_path << ": " << std::strerror(errno) << std::endl;
+		return 1;
+	}
+
+	//This thread only accepts; reading, parsing and solving run as pool
+	//tasks. A client that stops sending gives its worker back after
+	//READ_TIMEOUT seconds.
+	GraphCache cache(cache_capacity);
+	for (;;)
+	{
+		int client = accept(listener, NULL, NULL);
+		if (client < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			std::cerr << "accept failed: " << std::strerror(errno) << std::endl;
+			break;
+		}
+		timeval timeout;
+		timeout.tv_sec = READ_TIMEOUT;
+		timeout.tv_usec = 0;
+		setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+		sharedPool().submit([client, &cache, &config]() {
+			std::string request;
+			if (readAll(client, request))
+			{
+				handleRequest(client, request, cache, config);
+			}
+			else
+			{
+				close(client);
+			}
+		});
+	}
+	close(listener);
+	unlink(socket_path.c_str());
+	return 1;
+}
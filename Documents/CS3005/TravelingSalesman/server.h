@@ -0,0 +1,35 @@
+#pragma once
+#include "graph.h"
+#include "registry.h"
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+//Parsed graphs with their bounds already set, keyed by a hash of the
+//request text they came from. Least recently used entries are dropped
+//once `capacity` graphs are held.
+class GraphCache
+{
+public:
+	GraphCache(size_t capacity);
+	std::shared_ptr<Graph> find(uint64_t key);
+	void insert(uint64_t key, std::shared_ptr<Graph> graph);
+private:
+	typedef std::list< std::pair<uint64_t, std::shared_ptr<Graph> > > Entries;
+	size_t mCapacity;
+	Entries mEntries;
+	std::unordered_map<uint64_t, Entries::iterator> mIndex;
+	std::mutex mMutex;
+};
+
+uint64_t contentHash(const std::string& text);
+
+//Listens on a Unix domain socket until killed. A client sends either a
+//graph in any format loadGraph reads or a line "cached <hash>" naming one it
+//sent before, then shuts down its write side. The reply is
+//"hash <hash>" followed by the result line, or a single "error: ..." line.
+int runServer(const std::string& socket_path, size_t cache_capacity, const SolveConfig& config);
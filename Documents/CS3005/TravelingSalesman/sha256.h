@@ -0,0 +1,20 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+//FIPS 180-4 SHA-256, for keys that must not collide by accident.
+class Sha256
+{
+public:
+	Sha256();
+	void update(const void* data, size_t size);
+	//64 lowercase hex digits. Call once, after the last update.
+	std::string hexDigest();
+private:
+	void compress(const unsigned char* block);
+	uint32_t mState[8];
+	unsigned char mBuffer[64];
+	size_t mBuffered;
+	uint64_t mLength;
+};
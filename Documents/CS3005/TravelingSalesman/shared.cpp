@@ -0,0 +1,278 @@
+#include "shared.h"
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+	"the best-tour slot needs lock-free atomics to work across processes");
+
+struct SharedInstance::Header
+{
+	char magic[4];
+	uint32_t version;
+	uint64_t size;
+	//Page aligned; the header and tour slot fill the pages before it.
+	uint64_t matrixOffset;
+	double maxEdge;
+	double minEdge;
+	//Set last by create, so attach never sees a half-copied matrix.
+	std::atomic<uint32_t> ready;
+	std::atomic<uint64_t> sequence;
+	std::atomic<double> bestWeight;
+};
+
+namespace {
+
+//Yields between tries; a slot still busy after this many is given up on.
+const int BUSY_RETRIES = 10000;
+
+std::string segmentName(const std::string& name) {
+	return name.empty() || name[0] != '/' ? "/" + name : name;
+}
+
+bool systemError(std::string& error, const std::string& what) {
+	error = what + ": " + std::strerror(errno);
+	return false;
+}
+
+size_t roundToPage(size_t bytes) {
+	size_t page = sysconf(_SC_PAGESIZE);
+	return (bytes + page - 1) / page * page;
+}
+
+}
+
+SharedInstance::SharedInstance()
+	:
+	mHeader(NULL), mTour(NULL), mHeadBytes(0), mMatrix(NULL), mMatrixBytes(0), mGraph() {
+}
+SharedInstance::~SharedInstance() {
+	close();
+}
+
+bool SharedInstance::create(const std::string& name, const Graph& graph, std::string& error) {
+	close();
+	int n = graph.getSize();
+	std::string path = segmentName(name);
+	int fd = shm_open(path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+	if (fd < 0)
+	{
+		return systemError(error, path);
+	}
+	size_t head = roundToPage(sizeof(Header) + size_t(n) * sizeof(int32_t));
+	size_t matrix = size_t(n) * n * sizeof(double);
+	//Reserve the pages now: a full /dev/shm would otherwise only show up
+	//as SIGBUS while copying.
+	int failed = posix_fallocate(fd, 0, head + matrix);
+	char* base = NULL;
+	if (failed == 0)
+	{
+		base = (char*)mmap(NULL, head + matrix, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	}
+	else
+	{
+		errno = failed;
+	}
+	if (base == NULL || base == MAP_FAILED)
+	{
+		systemError(error, path);
+		::close(fd);
+		shm_unlink(path.c_str());
+		return false;
+	}
+	::close(fd);
+	mHeader = new (base) Header();
+	mTour = (std::atomic<int32_t>*)(base + sizeof(Header));
+	mHeadBytes = head;
+	double* rows = (double*)(base + head);
+	for (int i = 0; i < n; i++)
+	{
+		std::memcpy(rows + size_t(i) * n, graph.getRow(i), n * sizeof(double));
+	}
+	mprotect(rows, matrix, PROT_READ);
+	mMatrix = rows;
+	mMatrixBytes = matrix;
+	mGraph.useSharedMatrix(mMatrix, n);
+	if (graph.hasBounds())
+	{
+		mGraph.setBounds(graph.getMaxWeight() / n, graph.getMinWeight() / n);
+	}
+	else
+	{
+		mGraph.setMaxWeight();
+		mGraph.setMinWeight();
+	}
+	std::memcpy(mHeader->magic, "TSPS", 4);
+	mHeader->version = 1;
+	mHeader->size = n;
+	mHeader->matrixOffset = head;
+	mHeader->maxEdge = mGraph.getMaxWeight() / n;
+	mHeader->minEdge = mGraph.getMinWeight() / n;
+	mHeader->sequence.store(0, std::memory_order_relaxed);
+	mHeader->bestWeight.store(std::numeric_limits<double>::max(), std::memory_order_relaxed);
+	mHeader->ready.store(1, std::memory_order_release);
+	return true;
+}
+
+bool SharedInstance::attach(const std::string& name, std::string& error) {
+	close();
+	std::string path = segmentName(name);
+	int fd = shm_open(path.c_str(), O_RDWR, 0);
+	if (fd < 0)
+	{
+		return systemError(error, path);
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0 || size_t(info.st_size) < sizeof(Header))
+	{
+		::close(fd);
+		error = path + ": not a shared instance";
+		return false;
+	}
+	Header* peek = (Header*)mmap(NULL, sizeof(Header), PROT_READ, MAP_SHARED, fd, 0);
+	if (peek == MAP_FAILED)
+	{
+		::close(fd);
+		return systemError(error, path);
+	}
+	bool valid = std::memcmp(peek->magic, "TSPS", 4) == 0 && peek->version == 1 && peek->size >= 2;
+	bool ready = peek->ready.load(std::memory_order_acquire) == 1;
+	uint64_t n = peek->size;
+	size_t head = peek->matrixOffset;
+	munmap(peek, sizeof(Header));
+	size_t matrix = n * n * sizeof(double);
+	if (!ready || !valid || head != roundToPage(sizeof(Header) + n * sizeof(int32_t))
+		|| size_t(info.st_size) != head + matrix)
+	{
+		::close(fd);
+		error = path + (valid && !ready ? ": still being filled" : ": not a shared instance");
+		return false;
+	}
+	char* base = (char*)mmap(NULL, head, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	void* rows = mmap(NULL, matrix, PROT_READ, MAP_SHARED, fd, head);
+	::close(fd);
+	if (base == MAP_FAILED || rows == MAP_FAILED)
+	{
+		systemError(error, path);
+		if (base != MAP_FAILED)
+		{
+			munmap(base, head);
+		}
+		if (rows != MAP_FAILED)
+		{
+			munmap(rows, matrix);
+		}
+		return false;
+	}
+	mHeader = (Header*)base;
+	mTour = (std::atomic<int32_t>*)(base + sizeof(Header));
+	mHeadBytes = head;
+	mMatrix = (const double*)rows;
+	mMatrixBytes = matrix;
+	mGraph.useSharedMatrix(mMatrix, n);
+	mGraph.setBounds(mHeader->maxEdge, mHeader->minEdge);
+	return true;
+}
+
+bool SharedInstance::remove(const std::string& name) {
+	return shm_unlink(segmentName(name).c_str()) == 0;
+}
+
+bool SharedInstance::isOpen() const {
+	return mHeader != NULL;
+}
+
+Graph& SharedInstance::getGraph() {
+	return mGraph;
+}
+
+bool SharedInstance::publish(const std::vector<int>& path, double weight) {
+	if (mHeader == NULL || path.size() != mHeader->size)
+	{
+		return false;
+	}
+	for (int attempt = 0; attempt < BUSY_RETRIES; attempt++)
+	{
+		if (weight >= mHeader->bestWeight.load(std::memory_order_relaxed))
+		{
+			return false;
+		}
+		uint64_t sequence = mHeader->sequence.load(std::memory_order_relaxed);
+		if ((sequence & 1) || !mHeader->sequence.compare_exchange_weak(sequence, sequence + 1, std::memory_order_acquire))
+		{
+			std::this_thread::yield();
+			continue;
+		}
+		std::atomic_thread_fence(std::memory_order_release);
+		//Another process may have published a better tour since the check.
+		bool better = weight < mHeader->bestWeight.load(std::memory_order_relaxed);
+		if (better)
+		{
+			for (size_t i = 0; i < path.size(); i++)
+			{
+				mTour[i].store(path[i], std::memory_order_relaxed);
+			}
+			mHeader->bestWeight.store(weight, std::memory_order_relaxed);
+		}
+		mHeader->sequence.store(better ? sequence + 2 : sequence, std::memory_order_release);
+		return better;
+	}
+	return false;
+}
+
+bool SharedInstance::readBest(std::vector<int>& path, double& weight) const {
+	if (mHeader == NULL)
+	{
+		return false;
+	}
+	std::vector<int> tour(mHeader->size);
+	for (int attempt = 0; attempt < BUSY_RETRIES; attempt++)
+	{
+		uint64_t before = mHeader->sequence.load(std::memory_order_acquire);
+		if (before == 0)
+		{
+			return false;
+		}
+		if (before & 1)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+		double best = mHeader->bestWeight.load(std::memory_order_relaxed);
+		for (size_t i = 0; i < tour.size(); i++)
+		{
+			tour[i] = mTour[i].load(std::memory_order_relaxed);
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (mHeader->sequence.load(std::memory_order_relaxed) == before)
+		{
+			path.swap(tour);
+			weight = best;
+			return true;
+		}
+	}
+	return false;
+}
+
+uint64_t SharedInstance::getPublished() const {
+	return mHeader == NULL ? 0 : mHeader->sequence.load(std::memory_order_relaxed) / 2;
+}
+
+void SharedInstance::close() {
+	if (mHeader == NULL)
+	{
+		return;
+	}
+	mGraph.setSize(0);
+	munmap(mHeader, mHeadBytes);
+	munmap((void*)mMatrix, mMatrixBytes);
+	mHeader = NULL;
+	mTour = NULL;
+	mMatrix = NULL;
+}
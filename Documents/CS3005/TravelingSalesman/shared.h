@@ -0,0 +1,47 @@
+#pragma once
+#include "graph.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//One instance in POSIX shared memory, so every solver process on a
+//machine reads a single copy of the matrix. Beside the matrix is a slot
+//holding the best tour any process has published. The slot is a seqlock:
+//a publisher moves the sequence to odd, writes, then moves it on to the
+//next even number; a reader retries while it is odd or has moved.
+class SharedInstance
+{
+public:
+	SharedInstance();
+	~SharedInstance();
+	//Creates segment `name` holding a copy of `graph`, which can then be
+	//dropped. Fails if the name is already in use.
+	bool create(const std::string& name, const Graph& graph, std::string& error);
+	//Maps a segment made by create. The matrix pages are read-only.
+	bool attach(const std::string& name, std::string& error);
+	//Unlinks the name; processes already attached keep their mapping.
+	static bool remove(const std::string& name);
+	bool isOpen() const;
+	//Backed by the shared matrix, with the creator's bounds. Valid while
+	//this object is open.
+	Graph& getGraph();
+	//Stores the tour if it beats the slot's. False if it does not, or if
+	//the slot stayed busy (a publisher died mid-write).
+	bool publish(const std::vector<int>& path, double weight);
+	//The slot's tour; false if nothing was published or the slot is busy.
+	bool readBest(std::vector<int>& path, double& weight) const;
+	//Tours stored in the slot so far, by every process.
+	uint64_t getPublished() const;
+	SharedInstance(const SharedInstance&) = delete;
+	SharedInstance& operator=(const SharedInstance&) = delete;
+private:
+	struct Header;
+	void close();
+	Header* mHeader;
+	std::atomic<int32_t>* mTour;
+	size_t mHeadBytes;
+	const double* mMatrix;
+	size_t mMatrixBytes;
+	Graph mGraph;
+};
@@ -0,0 +1,21 @@
+#include "strategy.h"
+
+namespace {
+
+thread_local std::string tStrategy = "main";
+
+}
+
+const std::string& currentStrategy() {
+	return tStrategy;
+}
+
+StrategyScope::StrategyScope(const std::string& strategy)
+	:
+	mPrevious(tStrategy) {
+	tStrategy = strategy;
+}
+
+StrategyScope::~StrategyScope() {
+	tStrategy = mPrevious;
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include <string>
+
+//Strategy the calling thread is working for; labels counters and
+//improvements. Threads start out as "main". ThreadPool tasks run under
+//the label of the thread that submitted them.
+const std::string& currentStrategy();
+
+class StrategyScope
+{
+public:
+	StrategyScope(const std::string& strategy);
+	~StrategyScope();
+private:
+	std::string mPrevious;
+};
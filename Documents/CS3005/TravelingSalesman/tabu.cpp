@@ -0,0 +1,168 @@
+#include "tabu.h"
+#include "heuristics.h"
+#include "rng.h"
+#include <algorithm>
+#include <stdint.h>
+#include <unordered_set>
+#include <utility>
+
+namespace {
+
+const size_t kMaxVisited = 1 << 20;
+
+//Zobrist key of the directed edge a->b. Keys are derived from the vertex
+//ids rather than stored in a table so memory does not grow with n.
+uint64_t edgeKey(int a, int b) {
+	return mix64((uint64_t(uint32_t(a)) << 32) | uint32_t(b));
+}
+
+uint64_t tourHash(const std::vector<int>& path) {
+	uint64_t hash = 0;
+	for (size_t i = 0; i < path.size(); i++)
+	{
+		hash ^= edgeKey(path[i], path[(i + 1) % path.size()]);
+	}
+	return hash;
+}
+
+uint64_t swapHash(std::vector<int>& path, int x, int y, uint64_t hash) {
+	int n = path.size();
+	int edges[4];
+	int count = getSwapEdges(n, x, y, edges);
+	for (int i = 0; i < count; i++)
+	{
+		hash ^= edgeKey(path[edges[i]], path[(edges[i] + 1) % n]);
+	}
+	std::swap(path[x], path[y]);
+	for (int i = 0; i < count; i++)
+	{
+		hash ^= edgeKey(path[edges[i]], path[(edges[i] + 1) % n]);
+	}
+	std::swap(path[x], path[y]);
+	return hash;
+}
+
+//Fixed-length ring of recent moves. Each vertex keeps a count of how many
+//ring entries mention it, so tabu status is a two-lookup check.
+class TabuList
+{
+public:
+	TabuList(int vertices, int tenure)
+		:
+		mCount(vertices, 0), mRing(std::max(tenure, 1), std::make_pair(-1, -1)), mNext(0) {
+	}
+	bool isTabu(int a, int b) const {
+		return mCount[a] > 0 || mCount[b] > 0;
+	}
+	void push(int a, int b) {
+		std::pair<int, int>& slot = mRing[mNext];
+		if (slot.first >= 0)
+		{
+			mCount[slot.first]--;
+			mCount[slot.second]--;
+		}
+		slot = std::make_pair(a, b);
+		mCount[a]++;
+		mCount[b]++;
+		mNext = (mNext + 1) % mRing.size();
+	}
+private:
+	std::vector<int> mCount;
+	std::vector< std::pair<int, int> > mRing;
+	size_t mNext;
+};
+
+}
+
+TabuParams defaultTabuParams(const Graph& g) {
+	TabuParams params;
+	params.iterations = 10000;
+	params.neighbours = 100;
+	params.tenure = std::max(1, std::min(g.getSize() / 4, 10));
+	params.stall = 1000;
+	return params;
+}
+
+std::vector<int> TSPTabuSearch(Graph& g) {
+	return TSPTabuSearch(g, defaultTabuParams(g));
+}
+
+std::vector<int> TSPTabuSearch(Graph& g, const TabuParams& params) {
+	SolveControl control(g, SolveClock::time_point::max());
+	return TSPTabuSearch(g, params, control);
+}
+
+std::vector<int> TSPTabuSearch(Graph& g, const TabuParams& params, SolveControl& control) {
+	std::vector<int> current = getRandomCycle(g);
+	if (current.size() < 3)
+	{
+		control.offer(current);
+		return current;
+	}
+	double current_weight = g.getPathWeight(current);
+	std::vector<int> best = current;
+	double best_quality = g.getQuality(current_weight);
+	control.offer(best, current_weight);
+	uint64_t hash = tourHash(current);
+	std::unordered_set<uint64_t> visited;
+	visited.insert(hash);
+	TabuList tabu(g.getSize() + 1, params.tenure);
+	SolverCounters counters;
+
+	int since_improvement = 0;
+	for (int it = 0; it < params.iterations && since_improvement < params.stall && !control.shouldStop(); it++)
+	{
+		int move_x = -1, move_y = -1;
+		double move_delta = 0.0;
+		uint64_t move_hash = 0;
+		for (int i = 0; i < params.neighbours; i++)
+		{
+			int x, y;
+			getRandomSwap(current, x, y);
+			uint64_t h = swapHash(current, x, y, hash);
+			if (visited.count(h))
+			{
+				continue;
+			}
+			double delta = getSwapDelta(g, current, x, y);
+			counters.evaluations++;
+			bool aspiration = g.getQuality(current_weight + delta) > best_quality;
+			if (tabu.isTabu(current[x], current[y]) && !aspiration)
+			{
+				continue;
+			}
+			if (move_x < 0 || delta < move_delta)
+			{
+				move_x = x;
+				move_y = y;
+				move_delta = delta;
+				move_hash = h;
+			}
+		}
+		since_improvement++;
+		if (move_x < 0)
+		{
+			continue;
+		}
+		tabu.push(current[move_x], current[move_y]);
+		std::swap(current[move_x], current[move_y]);
+		current_weight += move_delta;
+		hash = move_hash;
+		if (visited.size() >= kMaxVisited)
+		{
+			visited.clear();
+		}
+		visited.insert(hash);
+		double current_quality = g.getQuality(current_weight);
+		if (current_quality > best_quality)
+		{
+			best = current;
+			best_quality = current_quality;
+			since_improvement = 0;
+			counters.improvements++;
+			control.offer(best, current_weight);
+		}
+	}
+	control.addCounters(counters);
+	return best;
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include "anytime.h"
+#include "graph.h"
+#include <vector>
+
+struct TabuParams
+{
+	int iterations;
+	int neighbours;
+	int tenure;
+	int stall;
+};
+
+TabuParams defaultTabuParams(const Graph& g);
+//Tabu search over the getRandomNeighbor swap neighbourhood. Recently
+//moved vertices are tabu for `tenure` moves and tours already visited are
+//skipped by hash before their weight is looked at.
+std::vector<int> TSPTabuSearch(Graph& g, const TabuParams& params);
+std::vector<int> TSPTabuSearch(Graph& g, const TabuParams& params, SolveControl& control);
+std::vector<int> TSPTabuSearch(Graph& g);
@@ -0,0 +1,75 @@
+#include "telemetry.h"
+#include "anytime.h"
+#include <cstdio>
+
+SolverCounters::SolverCounters()
+	:
+	evaluations(0), improvements(0), restarts(0) {
+}
+
+void SolverCounters::add(const SolverCounters& other) {
+	evaluations += other.evaluations;
+	improvements += other.improvements;
+	restarts += other.restarts;
+}
+
+std::string jsonString(const std::string& text) {
+	std::string out = "\"";
+	for (size_t i = 0; i < text.size(); i++)
+	{
+		char c = text[i];
+		if (c == '"' || c == '\\')
+		{
+			out += '\\';
+			out += c;
+		}
+		else if ((unsigned char)c < 0x20)
+		{
+			char escape[8];
+			std::snprintf(escape, sizeof(escape), "\\u%04x", c);
+			out += escape;
+		}
+		else
+		{
+			out += c;
+		}
+	}
+	return out + "\"";
+}
+
+void writeTelemetryJson(std::ostream& out, const SolveControl& control) {
+	double elapsed = control.getElapsed();
+	double best = control.getBestWeight();
+	std::map<std::string, SolverCounters> counters = control.getCounters();
+	std::vector<ImprovementEvent> timeline = control.getTimeline();
+
+	out << "{\"elapsed\":" << elapsed;
+	if (!timeline.empty())
+	{
+		out << ",\"best_weight\":" << best << ",\"best_quality\":" << control.getGraph().getQuality(best);
+	}
+	out << ",\"counters\":{";
+	for (std::map<std::string, SolverCounters>::const_iterator it = counters.begin(); it != counters.end(); ++it)
+	{
+		if (it != counters.begin())
+		{
+			out << ',';
+		}
+		const SolverCounters& c = it->second;
+		out << jsonString(it->first) << ":{\"evaluations\":" << c.evaluations
+			<< ",\"improvements\":" << c.improvements
+			<< ",\"restarts\":" << c.restarts
+			<< ",\"evaluations_per_sec\":" << (elapsed > 0.0 ? c.evaluations / elapsed : 0.0) << '}';
+	}
+	out << "},\"timeline\":[";
+	for (size_t i = 0; i < timeline.size(); i++)
+	{
+		if (i > 0)
+		{
+			out << ',';
+		}
+		out << "{\"t\":" << timeline[i].seconds << ",\"weight\":" << timeline[i].weight
+			<< ",\"quality\":" << timeline[i].quality << ",\"strategy\":" << jsonString(timeline[i].strategy) << '}';
+	}
+	out << "]}";
+}
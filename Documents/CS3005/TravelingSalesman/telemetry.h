@@ -0,0 +1,34 @@
+#pragma once
+#include "strategy.h"
+#include <iostream>
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class SolveControl;
+
+//Solvers count into a local SolverCounters on their own thread and hand
+//it to SolveControl::addCounters once, when they finish.
+struct SolverCounters
+{
+	SolverCounters();
+	void add(const SolverCounters& other);
+	uint64_t evaluations;
+	uint64_t improvements;
+	uint64_t restarts;
+};
+
+struct ImprovementEvent
+{
+	double seconds;
+	double weight;
+	double quality;
+	std::string strategy;
+};
+
+std::string jsonString(const std::string& text);
+//One JSON object, on one line: elapsed time, best tour weight and
+//quality, per-strategy counters with evaluations per second, and the
+//improvement timeline.
+void writeTelemetryJson(std::ostream& out, const SolveControl& control);
@@ -0,0 +1,351 @@
+#include "atsp.h"
+#include "checkpoint.h"
+#include "gpx.h"
+#include "graph.h"
+#include "heuristics.h"
+#include "parallel.h"
+#include "pool.h"
+#include "registry.h"
+#include "resultcache.h"
+#include "rng.h"
+#include "strategy.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//Unit checks for the parts the sample graphs in expected_results.txt do
+//not reach. Prints every failed check and exits non-zero if there was one.
+
+namespace {
+
+int gFailures = 0;
+
+void check(bool ok, const std::string& what) {
+	if (!ok)
+	{
+		std::cerr << "FAILED: " << what << std::endl;
+		gFailures++;
+	}
+}
+
+//A complete graph with random weights in [1, 101), asymmetric unless
+//`symmetric`, zero on the diagonal, bounds set.
+Graph randomGraph(int n, uint64_t seed, bool symmetric) {
+	CounterRng rng(seed, 0);
+	std::vector< std::vector<double> > rows(n, std::vector<double>(n, 0.0));
+	for (int i = 0; i < n; i++)
+	{
+		for (int j = 0; j < n; j++)
+		{
+			if (i != j && (!symmetric || j > i))
+			{
+				rows[i][j] = 1.0 + 100.0 * rng.unit();
+				if (symmetric)
+				{
+					rows[j][i] = rows[i][j];
+				}
+			}
+		}
+	}
+	Graph g;
+	g.setSize(n);
+	for (int i = 0; i < n; i++)
+	{
+		g.pushBack(rows[i], i + 1);
+	}
+	g.setMaxWeight();
+	g.setMinWeight();
+	return g;
+}
+
+//A copy of g's weights built from scratch, with fresh bounds and lists.
+Graph rebuild(const Graph& g) {
+	int n = g.getSize();
+	Graph copy;
+	copy.setSize(n);
+	for (int i = 0; i < n; i++)
+	{
+		copy.setRow(i, g.getRow(i));
+	}
+	copy.setMaxWeight();
+	copy.setMinWeight();
+	return copy;
+}
+
+bool isTour(const std::vector<int>& path, int n) {
+	if ((int)path.size() != n)
+	{
+		return false;
+	}
+	std::vector<char> seen(n + 1, 0);
+	for (size_t i = 0; i < path.size(); i++)
+	{
+		if (path[i] < 1 || path[i] > n || seen[path[i]])
+		{
+			return false;
+		}
+		seen[path[i]] = 1;
+	}
+	return true;
+}
+
+std::string tempDirectory() {
+	const char* base = std::getenv("TMPDIR");
+	std::string path = std::string(base != NULL && *base ? base : "/tmp") + "/tsp-tests-" + std::to_string(getpid());
+	mkdir(path.c_str(), 0755);
+	return path;
+}
+
+void testPool() {
+	std::atomic<int> ran(0);
+	std::atomic<int> mislabelled(0);
+	{
+		ThreadPool pool(3, 8);
+		StrategyScope scope("tests");
+		for (int i = 0; i < 200; i++)
+		{
+			pool.submit([&ran, &mislabelled]() {
+				if (currentStrategy() != "tests")
+				{
+					mislabelled++;
+				}
+				ran++;
+			});
+		}
+	}
+	check(ran == 200, "pool runs every submitted task before it is destroyed");
+	check(mislabelled == 0, "pool tasks run under the submitter's strategy");
+
+	ThreadPool pool(1, 1);
+	std::promise<void> release;
+	std::shared_future<void> released = release.get_future().share();
+	std::promise<void> started;
+	pool.submit([released, &started]() {
+		started.set_value();
+		released.wait();
+	});
+	started.get_future().wait();
+	pool.submit([]() {});
+	check(!pool.trySubmit([]() {}), "trySubmit gives up on a full queue");
+	release.set_value();
+}
+
+void testParallelFor() {
+	std::vector<int> hits(10007, 0);
+	parallelFor(hits.size(), [&hits](size_t i) {
+		hits[i]++;
+	});
+	bool once = true;
+	for (size_t i = 0; i < hits.size(); i++)
+	{
+		once = once && hits[i] == 1;
+	}
+	check(once, "parallelFor visits every index exactly once");
+
+	//From inside a pool task, as the portfolio and restartAndMerge do.
+	std::promise<long> sum;
+	std::future<long> result = sum.get_future();
+	sharedPool().submit([&sum]() {
+		std::vector<long> values(1000, 0);
+		parallelFor(values.size(), [&values](size_t i) {
+			values[i] = i;
+		});
+		long total = 0;
+		for (size_t i = 0; i < values.size(); i++)
+		{
+			total += values[i];
+		}
+		sum.set_value(total);
+	});
+	bool finished = result.wait_for(std::chrono::seconds(10)) == std::future_status::ready;
+	check(finished && result.get() == 999L * 1000 / 2, "parallelFor inside a pool task completes");
+}
+
+void testCounterRng() {
+	CounterRng a(7, 3), b(7, 3), other(7, 4);
+	bool same = true, differs = false, in_range = true;
+	for (int i = 0; i < 100; i++)
+	{
+		uint64_t x = a.next();
+		same = same && x == b.next();
+		differs = differs || x != other.next();
+	}
+	CounterRng resumed = CounterRng::fromState(a.getKey(), a.getCounter());
+	for (int i = 0; i < 100; i++)
+	{
+		same = same && a.next() == resumed.next();
+		in_range = in_range && a.below(10) < 10 && resumed.below(10) < 10;
+	}
+	check(same, "CounterRng repeats for the same seed, stream and state");
+	check(differs, "CounterRng streams differ");
+	check(in_range, "CounterRng::below stays below its bound");
+	std::vector<int> first, second;
+	{
+		RngScope scope(11, 2);
+		Graph g = randomGraph(30, 5, false);
+		first = getRandomCycle(g);
+	}
+	{
+		RngScope scope(11, 2);
+		Graph g = randomGraph(30, 5, false);
+		second = getRandomCycle(g);
+	}
+	check(first == second, "RngScope makes a heuristic repeatable");
+}
+
+void testPartitionCrossover() {
+	Graph g = randomGraph(80, 9, false);
+	bool valid = true, no_worse = true;
+	for (int r = 0; r < 40; r++)
+	{
+		RngScope scope(r + 1, 0);
+		std::vector<int> a = TSPAsymmetricSearch(g);
+		std::vector<int> b = TSPAsymmetricSearch(g);
+		std::vector<int> child = partitionCrossover(g, a, b);
+		valid = valid && isTour(child, g.getSize()) && child[0] == 1;
+		no_worse = no_worse && g.getPathWeight(child) <= std::min(g.getPathWeight(a), g.getPathWeight(b)) + 1e-9;
+	}
+	check(valid, "partitionCrossover returns a tour starting at vertex 1");
+	check(no_worse, "partitionCrossover is never worse than the better parent");
+}
+
+void testCheckpoint(const std::string& directory) {
+	Graph g = randomGraph(20, 3, false);
+	std::string path = directory + "/state.ckpt";
+	AnytimeState state;
+	state.restart = 5;
+	state.rngKey = 123;
+	state.rngCounter = 456;
+	state.elapsed = 1.5;
+	{
+		RngScope scope(1, 0);
+		state.bestPath = getRandomCycle(g);
+	}
+	uint64_t fingerprint = g.getFingerprint();
+	check(writeCheckpoint(path, fingerprint, state), "checkpoint is written");
+	AnytimeState read;
+	bool ok = readCheckpoint(path, g, fingerprint, read);
+	check(ok && read.restart == 5 && read.rngKey == 123 && read.rngCounter == 456 && read.elapsed == 1.5
+		&& read.bestPath == state.bestPath, "checkpoint reads back what was written");
+	check(!readCheckpoint(path, g, fingerprint + 1, read), "checkpoint of another graph is rejected");
+	Graph smaller = randomGraph(19, 3, false);
+	check(!readCheckpoint(path, smaller, fingerprint, read), "checkpoint of another size is rejected");
+	AnytimeState repeated = state;
+	repeated.bestPath[1] = repeated.bestPath[0];
+	writeCheckpoint(path, fingerprint, repeated);
+	check(!readCheckpoint(path, g, fingerprint, read), "checkpoint whose tour repeats a vertex is rejected");
+	std::remove(path.c_str());
+}
+
+void testResultCache(const std::string& directory) {
+	Graph g = randomGraph(25, 4, false);
+	SolveConfig config = defaultSolveConfig();
+	std::string key = getResultKey(g, config);
+	SolveConfig longer = config;
+	longer.budget = config.budget + 1000;
+	check(key.size() == 64 && key.find_first_not_of("0123456789abcdef") == std::string::npos, "result key is 64 hex digits");
+	check(key != getResultKey(g, longer), "result key follows the config");
+	std::vector<int> good, bad;
+	{
+		RngScope scope(2, 0);
+		good = TSPAsymmetricSearch(g);
+		bad = getRandomCycle(g);
+	}
+	if (g.getPathWeight(bad) < g.getPathWeight(good))
+	{
+		std::swap(good, bad);
+	}
+	std::string error;
+	check(writeCachedResult(directory, key, g, good, error), "result is cached");
+	check(!writeCachedResult(directory, key, g, bad, error) && error.empty(), "a worse result does not replace a better one");
+	std::vector<int> cached;
+	check(readCachedResult(directory, key, g, cached) && cached == good, "cached result reads back");
+	Graph other = randomGraph(24, 4, false);
+	check(!readCachedResult(directory, key, other, cached), "cached result for another size is rejected");
+	std::string entry = directory + "/" + key + ".tour";
+	{
+		std::ofstream out(entry.c_str());
+		out << "3 1.0\n1 1 2\n";
+	}
+	check(!readCachedResult(directory, key, g, cached), "cached result that is not a tour is rejected");
+	std::remove(entry.c_str());
+}
+
+void testSetWeight() {
+	int n = 30;
+	Graph g = randomGraph(n, 6, false);
+	g.getNeighbours(4);
+	//Below every weight, so both the new minimum and row 2's nearest.
+	g.setWeight(2, 7, 0.5);
+	Graph fresh = rebuild(g);
+	check(g.getMinWeight() == fresh.getMinWeight(), "setWeight lowers the minimum bound");
+	check(g.getMaxWeight() == fresh.getMaxWeight(), "setWeight keeps the maximum bound");
+	check(g.getNeighbours(4)->getIds(2)[0] == 7, "setWeight moves a closer vertex to the front of the list");
+	//The old minimum grows back and a listed neighbour leaves the list.
+	g.setWeight(2, 7, 200.0);
+	int listed = g.getNeighbours(4)->getIds(5)[0];
+	g.setWeight(5, listed, 150.0);
+	fresh = rebuild(g);
+	check(g.getMinWeight() == fresh.getMinWeight(), "setWeight restores the minimum bound");
+	check(g.getMaxWeight() == fresh.getMaxWeight(), "setWeight raises the maximum bound");
+	std::shared_ptr<const NeighbourLists> patched = g.getNeighbours(4);
+	std::shared_ptr<const NeighbourLists> built = fresh.getNeighbours(4);
+	check(patched->count == built->count && patched->ids == built->ids && patched->weights == built->weights,
+		"patched neighbour lists match lists built from scratch");
+}
+
+void testQuantisation() {
+	Graph g = randomGraph(40, 8, false);
+	Graph quantised;
+	std::string error;
+	bool ok = quantised.quantiseFrom(g, error);
+	check(ok, "graph quantises: " + error);
+	if (!ok)
+	{
+		return;
+	}
+	double error_bound = quantised.getQuantisationError();
+	bool within = true, exact = true;
+	for (int r = 0; r < 100; r++)
+	{
+		RngScope scope(r, 1);
+		std::vector<int> path = getRandomCycle(g);
+		double weight = g.getPathWeight(path);
+		within = within && std::fabs(quantised.getPathWeight(path) - weight) <= g.getSize() * error_bound + 1e-9;
+		exact = exact && std::fabs(quantised.getExactPathWeight(path) - weight) <= 1e-9 * weight;
+	}
+	check(error_bound > 0.0 && error_bound < 101.0 / 65535, "quantisation error is under one level");
+	check(within, "quantised tour weights stay within n times the error");
+	check(exact, "exact tour weights of a quantised graph match the source");
+}
+
+}
+
+int main() {
+	std::string directory = tempDirectory();
+	testPool();
+	testParallelFor();
+	testCounterRng();
+	testPartitionCrossover();
+	testCheckpoint(directory);
+	testResultCache(directory);
+	testSetWeight();
+	testQuantisation();
+	rmdir(directory.c_str());
+	if (gFailures > 0)
+	{
+		std::cerr << gFailures << " check(s) failed" << std::endl;
+		return 1;
+	}
+	std::cout << "all checks passed" << std::endl;
+	return 0;
+}